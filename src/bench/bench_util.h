@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+class Timer {
+public:
+  Timer() : start(std::chrono::steady_clock::now()) {}
+  void   Reset()         { start = std::chrono::steady_clock::now(); }
+  double Seconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+private:
+  std::chrono::steady_clock::time_point start;
+};
+
+// peak resident set size of this process in bytes
+inline std::uint64_t peak_rss() {
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+    return (std::uint64_t)pmc.PeakWorkingSetSize;
+  }
+  return 0;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  return (std::uint64_t)usage.ru_maxrss;        // bytes
+#else
+  return (std::uint64_t)usage.ru_maxrss * 1024; // kilobytes
+#endif
+#endif
+}
+
+struct Stats {
+  double min;
+  double mean;
+  double median;
+  double p99;
+  int    reps;
+};
+
+// seconds per call of func(), warmup calls are not recorded
+template<typename F>
+Stats measure(int warmup, int reps, F&& func) {
+  for (int i = 0; i < warmup; i++) {
+    func();
+  }
+  std::vector<double> samples(std::max(reps, 1));
+  for (auto& s : samples) {
+    Timer timer;
+    func();
+    s = timer.Seconds();
+  }
+  std::sort(samples.begin(), samples.end());
+  Stats stats;
+  stats.reps   = (int)samples.size();
+  stats.min    = samples.front();
+  stats.median = samples[samples.size() / 2];
+  stats.p99    = samples[std::min(samples.size() - 1, (size_t)(samples.size() * 0.99))];
+  stats.mean   = 0.0;
+  for (double s : samples) {
+    stats.mean += s;
+  }
+  stats.mean /= (double)samples.size();
+  return stats;
+}
@@ -0,0 +1,236 @@
+#include "core/scene_cloth.h"
+#include "core/scene_softbody.h"
+#include "core/cloth_batch.h"
+#include "core/collider.h"
+#include "bench/bench_util.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+  const char* MAT_NAME[eMat_Max]             = { "Concrete", "Wood", "Leather", "Tendon", "Rubber", "Muscle", "Fat" };
+  const char* PRECISION_NAME[ePrecision_Max] = { "float", "double", "mixed" };
+
+  struct Options {
+    std::vector<int> divisions;  // empty : the default of the scene
+    bool             softbody;   // tet box of div^3 cubes (or --mesh) instead of a div^2 cloth
+    std::string      mesh;       // TetGen base name, replaces the generated box
+    int              model;      // eTetModel of the soft body
+    int              mat;
+    int              num_step;
+    int              num_warmup;
+    int              num_batch;  // 0 : one SceneCloth, otherwise a ClothBatch of num_batch instances
+    int              precision;
+    Colliders        colliders;  // proxies under the hanging cloth, see --colliders
+    Params           params;
+    Options() : divisions(), softbody(false), mesh(), model(eTetModel_Volume), mat(eMat_Fat), num_step(100), num_warmup(10), num_batch(0), precision(ePrecision_Float), colliders(), params() {}
+  };
+
+  void usage(const char* exe) {
+    printf("usage: %s [options]\n", exe);
+    printf("  --scene NAME       cloth|softbody (default cloth)\n");
+    printf("  --div N[,N...]     cloth divisions (default 16,32,64,128,256), soft body cubes per side (default 8,16,26,32)\n");
+    printf("  --mesh PATH        soft body from a TetGen .node/.ele pair instead of the box\n");
+    printf("  --model NAME       volume|neohookean soft body constraints (default volume)\n");
+    printf("  --mat NAME         Concrete|Wood|Leather|Tendon|Rubber|Muscle|Fat (default Fat)\n");
+    printf("  --iter N           solver iterations per step (default 20)\n");
+    printf("  --substeps N       use the substep integrator with N substeps\n");
+    printf("  --solver NAME      gs|jacobi (default gs)\n");
+    printf("  --chebyshev RHO    chebyshev acceleration of the iterations, RHO 0 estimates the spectral radius\n");
+    printf("  --tolerance TOL    stop iterating once max |C + a~ lambda| of a pass is below TOL\n");
+    printf("  --bend-interval N  solve bend constraints on every N-th pass only\n");
+    printf("  --bend-compliance NAME  material of the bend constraints (default --mat)\n");
+    printf("  --steps N          timed steps per division (default 100)\n");
+    printf("  --warmup N         untimed steps before timing (default 10)\n");
+    printf("  --threads N        worker threads including the caller (default all cores)\n");
+    printf("  --precision NAME   float|double|mixed, mixed keeps float positions and double lambdas (default float)\n");
+    printf("  --batch N          step N instances per division together in a ClothBatch (gauss-seidel only)\n");
+    printf("  --colliders LIST   any of floor,sphere,capsule,box separated by commas, collided after every pass (not with --batch)\n");
+    printf("  --self-collision N 1 : cloth point-point and point-triangle self collision (not with --batch)\n");
+    printf("  --ccd N            1 : continuous collision of the prediction against the colliders and the cloth itself (not with --batch)\n");
+    printf("  --sleep N          1 : settled islands of the cloth sleep until something wakes them (not with --batch)\n");
+  }
+
+  std::vector<int> parse_list(const char* arg) {
+    std::vector<int> list;
+    for (const char* p = arg; *p; ) {
+      list.push_back(atoi(p));
+      const char* comma = strchr(p, ',');
+      if (comma == nullptr) { break; }
+      p = comma + 1;
+    }
+    return list;
+  }
+
+  bool parse(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; i++) {
+      std::string key = argv[i];
+      if ((key == "-h") || (key == "--help")) { return false; }
+      if (i + 1 >= argc) { fprintf(stderr, "missing value for %s\n", key.c_str()); return false; }
+      const char* val = argv[++i];
+      if (key == "--scene") {
+        opt.softbody = (strcmp(val, "softbody") == 0);
+      } else if (key == "--div") {
+        opt.divisions = parse_list(val);
+      } else if (key == "--mesh") {
+        opt.softbody = true;
+        opt.mesh     = val;
+      } else if (key == "--model") {
+        opt.model = (strcmp(val, "neohookean") == 0) ? eTetModel_NeoHookean : eTetModel_Volume;
+      } else if (key == "--mat") {
+        opt.mat = -1;
+        for (int m = 0; m < eMat_Max; m++) {
+          if (strcmp(val, MAT_NAME[m]) == 0) { opt.mat = m; }
+        }
+        if (opt.mat < 0) { fprintf(stderr, "unknown material %s\n", val); return false; }
+      } else if (key == "--iter") {
+        opt.params.num_iteration = std::max(atoi(val), 1);
+      } else if (key == "--substeps") {
+        opt.params.integrator  = eIntegrator_Substep;
+        opt.params.num_substep = std::max(atoi(val), 1);
+      } else if (key == "--solver") {
+        opt.params.solver = (strcmp(val, "jacobi") == 0) ? eSolver_Jacobi : eSolver_GaussSeidel;
+      } else if (key == "--chebyshev") {
+        opt.params.chebyshev       = true;
+        opt.params.spectral_radius = (float)atof(val);
+      } else if (key == "--tolerance") {
+        opt.params.tolerance = (float)atof(val);
+      } else if (key == "--bend-interval") {
+        opt.params.batch[eConstraint_Bend].interval = std::max(atoi(val), 1);
+      } else if (key == "--bend-compliance") {
+        int mat = -1;
+        for (int m = 0; m < eMat_Max; m++) {
+          if (strcmp(val, MAT_NAME[m]) == 0) { mat = m; }
+        }
+        if (mat < 0) { fprintf(stderr, "unknown material %s\n", val); return false; }
+        opt.params.batch[eConstraint_Bend].compliance = MAT_COMPLIANCE[mat];
+      } else if (key == "--steps") {
+        opt.num_step = std::max(atoi(val), 1);
+      } else if (key == "--warmup") {
+        opt.num_warmup = std::max(atoi(val), 0);
+      } else if (key == "--threads") {
+        opt.params.num_thread = std::max(atoi(val), 1);
+      } else if (key == "--precision") {
+        opt.precision = (strcmp(val, "double") == 0) ? ePrecision_Double : (strcmp(val, "mixed") == 0) ? ePrecision_Mixed : ePrecision_Float;
+      } else if (key == "--batch") {
+        opt.num_batch = std::max(atoi(val), 0);
+      } else if (key == "--self-collision") {
+        opt.params.self_collision = (atoi(val) != 0);
+      } else if (key == "--ccd") {
+        opt.params.ccd = (atoi(val) != 0);
+      } else if (key == "--sleep") {
+        opt.params.sleep = (atoi(val) != 0);
+      } else if (key == "--colliders") {
+        opt.colliders.Clear();
+        if (strstr(val, "floor"))   { opt.colliders.AddPlane(glm::vec4(0.0f, 1.0f, 0.0f, 0.0f)); }
+        if (strstr(val, "sphere"))  { opt.colliders.AddSphere(glm::vec3(0.0f, 1.6f, 1.3f), 0.4f); }
+        if (strstr(val, "capsule")) { opt.colliders.AddCapsule(glm::vec3(-0.8f, 1.0f, 1.1f), glm::vec3(0.8f, 1.0f, 1.1f), 0.15f); }
+        if (strstr(val, "box"))     { opt.colliders.AddBox(glm::vec3(0.0f, 0.5f, 1.3f), glm::vec3(0.4f, 0.1f, 0.4f)); }
+      } else {
+        fprintf(stderr, "unknown option %s\n", key.c_str());
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template<typename SceneType>
+  void run(Options& opt, SceneType& scene, const std::string& label) {
+    Params& params = opt.params;
+    for (int i = 0; i < opt.num_warmup; i++) {
+      scene.Update(params, FIXED_DT);
+    }
+    Timer  timer;
+    double num_pass = 0.0;
+    for (int i = 0; i < opt.num_step; i++) {
+      scene.Update(params, FIXED_DT);
+      num_pass += scene.GetStats().num_iteration;
+    }
+    double sec = timer.Seconds();
+    double ns  = sec * 1.0e9 / (num_pass * scene.NumConstraints());
+    printf("%10s %10d %12d %10.1f %12.3f %14.1f %10.1f\n", label.c_str(), scene.GetPoints().Size(), scene.NumConstraints(),
+           opt.num_step / sec, ns, (double)peak_rss() / (1024.0 * 1024.0), num_pass / opt.num_step);
+  }
+
+  template<typename Real, typename Lambda = Real>
+  void run_cloth(Options& opt, const Vec2& width, const glm::ivec2& division, const Vec3& pos) {
+    SceneCloth<Real, Lambda> scene(width, division, pos);
+    run(opt, scene, std::to_string(division.x) + "x" + std::to_string(division.y));
+  }
+
+  template<typename Real, typename Lambda = Real>
+  void run_softbody(Options& opt, const TetMesh& mesh, const std::string& label, const Vec3& pos) {
+    SceneSoftBody<Real, Lambda> scene(mesh, opt.model, pos);
+    run(opt, scene, label);
+  }
+};
+
+int main(int argc, char* argv[]) {
+  Options opt;
+  if (!parse(argc, argv, opt)) {
+    usage(argv[0]);
+    return 1;
+  }
+  ThreadPool pool(opt.params.num_thread);
+  Params&    params = opt.params;
+  params.thread_pool    = &pool;
+  params.mat_compliance = opt.mat;
+  params.compliance     = MAT_COMPLIANCE[opt.mat];
+  params.colliders      = opt.colliders.Empty() ? nullptr : &opt.colliders;
+  int passes = (params.integrator == eIntegrator_Substep) ? params.num_substep : params.num_iteration;
+  printf("material %s, %s, %s%s, %s x %d, %d threads, %d steps\n", MAT_NAME[opt.mat], PRECISION_NAME[opt.precision],
+         (params.solver == eSolver_Jacobi) ? "jacobi" : "gauss-seidel", params.chebyshev ? " + chebyshev" : "",
+         (params.integrator == eIntegrator_Substep) ? "substeps" : "iterations", passes, pool.NumThreads(), opt.num_step);
+  printf("%10s %10s %12s %10s %12s %14s %10s\n", opt.softbody ? "cubes" : "division", "points", "constraints", "steps/s", "ns/c/iter", "peak RSS(MB)", "avg iter");
+  if (opt.softbody) {
+    Vec3 pos((Float)0.0, (Float)2.0, (Float)0.0);
+    std::vector<std::pair<std::string, TetMesh>> meshes;
+    if (!opt.mesh.empty()) {
+      meshes.push_back(std::make_pair(std::string("mesh"), TetMesh()));
+      if (!LoadTetGen(opt.mesh, meshes.back().second)) {
+        fprintf(stderr, "cannot read %s.node/.ele\n", opt.mesh.c_str());
+        return 1;
+      }
+    } else {
+      for (int div : opt.divisions.empty() ? std::vector<int>({ 8, 16, 26, 32 }) : opt.divisions) {
+        meshes.push_back(std::make_pair(std::to_string(div) + "^3", MakeTetBox(Vec3((Float)1.0), glm::ivec3(std::max(div, 1)))));
+      }
+    }
+    for (const auto& mesh : meshes) {
+      switch (opt.precision) {
+      case ePrecision_Double: run_softbody<double>(opt, mesh.second, mesh.first, pos);        break;
+      case ePrecision_Mixed:  run_softbody<float, double>(opt, mesh.second, mesh.first, pos); break;
+      default:                run_softbody<float>(opt, mesh.second, mesh.first, pos);         break;
+      }
+    }
+    return 0;
+  }
+  for (int div : opt.divisions.empty() ? std::vector<int>({ 16, 32, 64, 128, 256 }) : opt.divisions) {
+    Vec2       width((Float)2.0, (Float)2.0);
+    Vec3       pos((Float)0.0, (Float)2.5, (Float)0.0);
+    glm::ivec2 division(div, div);
+    if (opt.num_batch > 0) {
+      ClothBatch batch(width, division, pos, opt.num_batch, params);
+      for (int i = 0; i < opt.num_warmup; i++) {
+        batch.Update(params, FIXED_DT);
+      }
+      Timer timer;
+      for (int i = 0; i < opt.num_step; i++) {
+        batch.Update(params, FIXED_DT);
+      }
+      double sec = timer.Seconds();
+      double ns  = sec * 1.0e9 / ((double)opt.num_step * passes * batch.NumConstraints() * batch.NumInstances());
+      printf("%6dx%-4d %10d %12d %10.1f %12.3f %14.1f %10d  (%d instances, %.0f instance steps/s)\n", div, div, batch.NumPoints(), batch.NumConstraints(),
+             opt.num_step / sec, ns, (double)peak_rss() / (1024.0 * 1024.0), passes, batch.NumInstances(), (double)opt.num_step * batch.NumInstances() / sec);
+      continue;
+    }
+    switch (opt.precision) {
+    case ePrecision_Double: run_cloth<double>(opt, width, division, pos);        break;
+    case ePrecision_Mixed:  run_cloth<float, double>(opt, width, division, pos); break;
+    default:                run_cloth<float>(opt, width, division, pos);         break;
+    }
+  }
+  return 0;
+}
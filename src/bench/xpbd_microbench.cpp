@@ -0,0 +1,278 @@
+#include "core/scene_cloth.h"
+#include "core/scene_softbody.h"
+#include "core/collider.h"
+#include "core/simd.h"
+#include "bench/bench_util.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <type_traits>
+
+namespace {
+  struct Options {
+    int         division;
+    int         num_rep;
+    int         num_warmup;
+    int         num_thread;
+    std::string phase;      // empty : all
+    bool        verify;     // check the vector kernels against the scalar path instead of timing
+    Options() : division(64), num_rep(200), num_warmup(20), num_thread(1), phase(), verify(false) {}
+  };
+
+  void usage(const char* exe) {
+    printf("usage: %s [options]\n", exe);
+    printf("  --div N        cloth division (default 64)\n");
+    printf("  --reps N       timed repetitions per phase (default 200)\n");
+    printf("  --warmup N     untimed repetitions per phase (default 20)\n");
+    printf("  --threads N    worker threads for the threaded phases (default 1)\n");
+    printf("  --phase NAME   construct|predict|solve_scalar|solve_simd|calc_normal|render_fill (default all)\n");
+    printf("  --verify       run every vector kernel and the scalar path on the same batches, exit 1 on a mismatch\n");
+  }
+
+  bool parse(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; i++) {
+      std::string key = argv[i];
+      if ((key == "-h") || (key == "--help")) { return false; }
+      if (key == "--verify") { opt.verify = true; continue; }
+      if (i + 1 >= argc) { fprintf(stderr, "missing value for %s\n", key.c_str()); return false; }
+      const char* val = argv[++i];
+      if (key == "--div") {
+        opt.division = std::max(atoi(val), 3);
+      } else if (key == "--reps") {
+        opt.num_rep = std::max(atoi(val), 1);
+      } else if (key == "--warmup") {
+        opt.num_warmup = std::max(atoi(val), 0);
+      } else if (key == "--threads") {
+        opt.num_thread = std::max(atoi(val), 1);
+      } else if (key == "--phase") {
+        opt.phase = val;
+      } else {
+        fprintf(stderr, "unknown option %s\n", key.c_str());
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void report(const char* name, int items, const Stats& s) {
+    printf("%-14s %10d %12.2f %12.2f %12.2f %12.2f %10.3f\n", name, items,
+           s.median * 1.0e6, s.p99 * 1.0e6, s.mean * 1.0e6, s.min * 1.0e6, s.median * 1.0e9 / std::max(items, 1));
+  }
+
+  // largest |a - b| over the larger of |b| and 1, so positions compare absolutely and large lambdas relatively
+  template<typename V>
+  double max_error(const V& a, const V& b) {
+    double error = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+      error = std::max(error, std::abs((double)a[i] - (double)b[i]) / std::max(std::abs((double)b[i]), 1.0));
+    }
+    return error;
+  }
+
+  // agreement expected of float kernels that only reorder or fuse the scalar arithmetic. the residual is looser,
+  // C of a hinge cancels terms k_i x_i about a hundred times larger than itself
+  const double VERIFY_TOLERANCE   = 1.0e-4;
+  const double RESIDUAL_TOLERANCE = 1.0e-3;
+
+  // NUM_PASS passes over the colors of a batch, once through simd and the scalar rest of every color and once through
+  // SolvePosition alone, from the same points. colors share no point, so both orders give the same result up to rounding.
+  // the uncolored rest is scalar either way and is left out. returns false on a mismatch
+  template<typename Constraint, typename Simd>
+  bool verify_batch(const char* name, const ConstraintBatch& batch, const Constraint* data, const Points<Float>& start, Float alpha, Simd simd) {
+    const int                NUM_PASS   = 4;
+    const int                num_lambda = Constraint::NUM_LAMBDA;
+    const int                num        = batch.color_offsets.empty() ? 0 : batch.color_offsets.back() - batch.begin;
+    Points<Float>            vec        = start, ref = start;
+    std::vector<Float>       vec_lambda((size_t)num * num_lambda, (Float)0.0), ref_lambda((size_t)num * num_lambda, (Float)0.0);
+    Float                    vec_res    = (Float)0.0, ref_res = (Float)0.0;
+    int                      num_simd   = 0;
+    for (int pass = 0; pass < NUM_PASS; pass++) {
+      vec_res = ref_res = (Float)0.0;
+      for (size_t k = 0; k + 1 < batch.color_offsets.size(); k++) {
+        int c   = batch.color_offsets[k] - batch.begin;
+        int end = batch.color_offsets[k + 1] - batch.begin;
+        int n   = simd(&data[c], &vec_lambda[(size_t)c * num_lambda], end - c, vec, alpha, vec_res);
+        num_simd += (pass == 0) ? n : 0;
+        for (c += n; c < end; c++) {
+          vec_res = std::max(vec_res, data[c].SolvePosition(vec, &vec_lambda[(size_t)c * num_lambda], alpha));
+        }
+      }
+      for (int c = 0; c < num; c++) {
+        ref_res = std::max(ref_res, data[c].SolvePosition(ref, &ref_lambda[(size_t)c * num_lambda], alpha));
+      }
+    }
+    double pos_error    = std::max(max_error(vec.pos_x, ref.pos_x), std::max(max_error(vec.pos_y, ref.pos_y), max_error(vec.pos_z, ref.pos_z)));
+    double lambda_error = max_error(vec_lambda, ref_lambda);
+    double res_error    = std::abs((double)vec_res - (double)ref_res) / std::max(std::abs((double)ref_res), 1.0);
+    bool   ok           = (pos_error <= VERIFY_TOLERANCE) && (lambda_error <= VERIFY_TOLERANCE) && (res_error <= RESIDUAL_TOLERANCE);
+    printf("%-14s %10d %10d %12.3e %12.3e %12.3e %6s\n", name, num, num_simd, pos_error, lambda_error, res_error, ok ? "ok" : "FAIL");
+    return ok;
+  }
+
+  // Colliders::Solve over whole blocks takes the lane groups, one point at a time it only takes the scalar path
+  bool verify_colliders(const Colliders& colliders, const Points<Float>& start) {
+    Points<Float> vec = start, ref = start;
+    Float         vec_depth = colliders.Solve(vec, 0, vec.Size()), ref_depth = (Float)0.0;
+    for (int i = 0; i < ref.Size(); i++) {
+      ref_depth = std::max(ref_depth, colliders.Solve(ref, i, i + 1));
+    }
+    int num_hit = 0;
+    for (int i = 0; i < ref.Size(); i++) {
+      num_hit += (ref.Position(i) != start.Position(i)) ? 1 : 0;
+    }
+    double pos_error = std::max(max_error(vec.pos_x, ref.pos_x), std::max(max_error(vec.pos_y, ref.pos_y), max_error(vec.pos_z, ref.pos_z)));
+    double res_error = std::abs((double)vec_depth - (double)ref_depth);
+    bool   ok        = (num_hit > 0) && (pos_error <= VERIFY_TOLERANCE) && (res_error <= RESIDUAL_TOLERANCE);
+    printf("%-14s %10d %10d %12.3e %12s %12.3e %6s\n", "colliders", vec.Size(), num_hit, pos_error, "-", res_error, ok ? "ok" : "FAIL");
+    return ok;
+  }
+
+  // points of scene a few steps in, then predicted once more so every constraint type starts violated
+  template<typename SceneType>
+  Points<Float> verify_points(SceneType& scene, Float dt) {
+    Params params;
+    for (int i = 0; i < 10; i++) {
+      scene.Update(params, dt);
+    }
+    Points<Float> points = scene.GetPoints();
+    points.Predict(dt, 0, points.Size());
+    return points;
+  }
+
+  int verify(const Options& opt) {
+    const Float dt    = FIXED_DT;
+    const Float alpha = (Float)MAT_COMPLIANCE[eMat_Fat] / (dt * dt);
+    auto distance = [](auto&&... a) { return SolveDistanceSimd(a...); };
+    auto dihedral = [](auto&&... a) { return SolveDihedralSimd(a...); };
+    auto volume   = [](auto&&... a) { return SolveVolumeSimd(a...); };
+    auto neo      = [](auto&&... a) { return SolveNeoHookeanSimd(a...); };
+    bool ok       = true;
+    printf("%s kernels\n", UseAvx2() ? "AVX2" : "SSE2");
+    printf("%-14s %10s %10s %12s %12s %12s %6s\n", "kernel", "items", "vector", "pos error", "lambda error", "res error", "");
+    SceneCloth<Float> cloth(Vec2((Float)2.0, (Float)2.0), glm::ivec2(opt.division, opt.division), Vec3((Float)0.0, (Float)2.5, (Float)0.0));
+    Points<Float>     cloth_points = verify_points(cloth, dt);
+    const char*       DISTANCE_NAME[eConstraint_Bend] = { "structural", "shear" };
+    for (int t = 0; t < eConstraint_Bend; t++) {
+      const ConstraintBatch& batch = cloth.GetBatch(t);
+      ok &= verify_batch(DISTANCE_NAME[t], batch, cloth.GetConstraints().data() + batch.begin, cloth_points, alpha, distance);
+    }
+    ok &= verify_batch("dihedral", cloth.GetBatch(eConstraint_Bend), cloth.GetBends().data(), cloth_points, alpha, dihedral);
+    TetMesh                box = MakeTetBox(Vec3((Float)1.0), glm::ivec3(std::max(opt.division / 8, 4))); // colors wider than a lane group
+    SceneSoftBody<Float>   soft(box, eTetModel_Volume, Vec3((Float)0.0, (Float)2.0, (Float)0.0));
+    Points<Float>          soft_points = verify_points(soft, dt);
+    ok &= verify_batch("volume", soft.GetBatch(eConstraint_Volume), soft.GetTets().data(), soft_points, alpha, volume);
+    SceneSoftBody<Float>   neo_soft(box, eTetModel_NeoHookean, Vec3((Float)0.0, (Float)2.0, (Float)0.0));
+    Points<Float>          neo_points = verify_points(neo_soft, dt);
+    ok &= verify_batch("deviatoric", neo_soft.GetBatch(eConstraint_Deviatoric), neo_soft.GetDeviatoric().data(), neo_points, alpha, neo);
+    ok &= verify_batch("hydrostatic", neo_soft.GetBatch(eConstraint_Hydrostatic), neo_soft.GetHydrostatic().data(), neo_points, alpha, neo);
+    glm::vec3 center(0.0f);
+    for (int i = 0; i < cloth_points.Size(); i++) {
+      center += glm::vec3(cloth_points.Position(i)) / (float)cloth_points.Size();
+    }
+    Colliders colliders; // every shape through the middle of the cloth
+    colliders.AddPlane(glm::vec4(0.0f, 1.0f, 0.0f, -center.y));
+    colliders.AddSphere(center + glm::vec3(0.3f, 0.0f, 0.0f), 0.3f);
+    colliders.AddCapsule(center - glm::vec3(0.8f, 0.0f, 0.2f), center + glm::vec3(0.8f, 0.0f, -0.2f), 0.1f);
+    colliders.AddBox(center - glm::vec3(0.4f, 0.0f, 0.0f), glm::vec3(0.2f, 0.1f, 0.2f), glm::mat3(glm::rotate(glm::mat4(1.0f), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f))));
+    ok &= verify_colliders(colliders, cloth_points);
+    printf("%s\n", ok ? "all kernels agree with the scalar path" : "vector kernels disagree with the scalar path");
+    return ok ? 0 : 1;
+  }
+};
+
+int main(int argc, char* argv[]) {
+  Options opt;
+  if (!parse(argc, argv, opt)) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (opt.verify) {
+    int result = verify(opt);
+    if (UseAvx2()) { // the SSE2 kernels as well
+      EnableAvx2(false);
+      result |= verify(opt);
+      EnableAvx2(true);
+    }
+    return result;
+  }
+  ThreadPool        pool(opt.num_thread);
+  Vec2              width((Float)2.0, (Float)2.0);
+  Vec3              pos((Float)0.0, (Float)2.5, (Float)0.0);
+  glm::ivec2        division(opt.division, opt.division);
+  SceneCloth<Float> scene(width, division, pos);
+  const Float       dt    = FIXED_DT;
+  const Float       alpha = (Float)MAT_COMPLIANCE[eMat_Fat] / (dt * dt);
+  auto              run   = [&](const char* name) { return opt.phase.empty() || (opt.phase == name); };
+
+  printf("%dx%d cloth, %d threads, %d reps after %d warm-up\n", opt.division, opt.division, pool.NumThreads(), opt.num_rep, opt.num_warmup);
+  printf("%-14s %10s %12s %12s %12s %12s %10s\n", "phase", "items", "median(us)", "p99(us)", "mean(us)", "min(us)", "ns/item");
+
+  if (run("construct")) {
+    int reps = std::max(opt.num_rep / 10, 1); // construction is far heavier than one step
+    report("construct", scene.NumConstraints(), measure(std::min(opt.num_warmup, reps), reps, [&]() {
+      SceneCloth<Float> tmp(width, division, pos);
+    }));
+  }
+  if (run("predict")) {
+    Points<Float> points = scene.GetPoints();
+    report("predict", points.Size(), measure(opt.num_warmup, opt.num_rep, [&]() {
+      ParallelFor(&pool, 0, points.Size(), 1024, [&](int begin, int end) { points.Predict(dt, begin, end); });
+    }));
+  }
+  if (run("solve_scalar")) {
+    Points<Float>                                 points      = scene.GetPoints();
+    const std::vector<DistanceConstraint<Float>>& constraints = scene.GetConstraints();
+    const std::vector<DihedralConstraint<Float>>& bends       = scene.GetBends();
+    std::vector<Float>                            lambdas(scene.NumLambdas(), (Float)0.0);
+    report("solve_scalar", scene.NumConstraints(), measure(opt.num_warmup, opt.num_rep, [&]() {
+      for (size_t c = 0; c < constraints.size(); c++) {
+        constraints[c].SolvePosition(points, &lambdas[c], alpha);
+      }
+      for (size_t c = 0; c < bends.size(); c++) {
+        bends[c].SolvePosition(points, &lambdas[constraints.size() + c * DihedralConstraint<Float>::NUM_LAMBDA], alpha);
+      }
+    }));
+  }
+  if (run("solve_simd")) {
+    Points<Float>      points   = scene.GetPoints();
+    std::vector<Float> lambdas(scene.NumLambdas(), (Float)0.0);
+    Float              residual = (Float)0.0;
+    auto solve = [&](const ConstraintBatch& batch, const auto* data, auto simd) { // data : constraint at batch.begin
+      const int num_lambda = std::remove_pointer_t<decltype(data)>::NUM_LAMBDA;
+      auto      lambda     = [&](int c) { return &lambdas[batch.lambda + (c - batch.begin) * num_lambda]; };
+      for (size_t k = 0; k + 1 < batch.color_offsets.size(); k++) {
+        int c   = batch.color_offsets[k];
+        int end = batch.color_offsets[k + 1];
+        c += simd(&data[c - batch.begin], lambda(c), end - c, points, alpha, residual);
+        for (; c < end; c++) {
+          data[c - batch.begin].SolvePosition(points, lambda(c), alpha);
+        }
+      }
+      for (int c = batch.color_offsets.back(); c < batch.end; c++) {
+        data[c - batch.begin].SolvePosition(points, lambda(c), alpha);
+      }
+    };
+    report("solve_simd", scene.NumConstraints(), measure(opt.num_warmup, opt.num_rep, [&]() {
+      for (int t = 0; t < eConstraint_Bend; t++) {
+        const ConstraintBatch& batch = scene.GetBatch(t);
+        solve(batch, scene.GetConstraints().data() + batch.begin, [](auto&&... a) { return SolveDistanceSimd(a...); });
+      }
+      solve(scene.GetBatch(eConstraint_Bend), scene.GetBends().data(), [](auto&&... a) { return SolveDihedralSimd(a...); });
+    }));
+  }
+  if (run("calc_normal")) {
+    report("calc_normal", scene.GetPoints().Size(), measure(opt.num_warmup, opt.num_rep, [&]() {
+      scene.CalcNormal(&pool);
+    }));
+  }
+  if (run("render_fill")) {
+    std::vector<float> vertices;
+    report("render_fill", (int)scene.GetTriangles().size(), measure(opt.num_warmup, opt.num_rep, [&]() {
+      scene.FillVertexBuffer(vertices);
+    }));
+  }
+  printf("peak RSS %.1f MB\n", (double)peak_rss() / (1024.0 * 1024.0));
+  return 0;
+}
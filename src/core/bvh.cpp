@@ -0,0 +1,205 @@
+#include "core/bvh.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+  const double REBUILD_RATIO = 1.5; // summed node area over the area right after the build
+
+  template<typename Real>
+  Real surface_area(const glm::vec<3, Real>& lo, const glm::vec<3, Real>& hi) {
+    glm::vec<3, Real> e = hi - lo;
+    return (Real)2.0 * (e.x * e.y + e.y * e.z + e.z * e.x);
+  }
+
+  // entry distance of origin + dir * t into the box, false if it misses [0, max_t)
+  template<typename Real>
+  bool slab(const glm::vec<3, Real>& lo, const glm::vec<3, Real>& hi, const glm::vec<3, Real>& origin, const glm::vec<3, Real>& inv_dir, Real max_t, Real& t_near) {
+    glm::vec<3, Real> t0 = (lo - origin) * inv_dir;
+    glm::vec<3, Real> t1 = (hi - origin) * inv_dir;
+    glm::vec<3, Real> tn = glm::min(t0, t1);
+    glm::vec<3, Real> tf = glm::max(t0, t1);
+    t_near = std::max(std::max(tn.x, tn.y), std::max(tn.z, (Real)0.0));
+    Real t_far = std::min(std::min(tf.x, tf.y), std::min(tf.z, max_t));
+    return t_near <= t_far;
+  }
+};
+
+template<typename Real>
+void TriangleBVH<Real>::Build(const Points<Real>& points, const std::vector<std::uint32_t>& triangles) {
+  struct Task {
+    int node;
+    int first;
+    int count;
+    int depth;
+  };
+  const int         num = (int)triangles.size() / 3;
+  std::vector<Vec3> centroid(num);
+  std::vector<int>  depth(1, 0);
+  std::vector<Task> stack;
+  for(int f = 0; f < num; f++) {
+    centroid[f] = (points.Position(triangles[f * 3]) + points.Position(triangles[f * 3 + 1]) + points.Position(triangles[f * 3 + 2])) / (Real)3.0;
+  }
+  tris.resize(num);
+  for(int f = 0; f < num; f++) {
+    tris[f] = f;
+  }
+  nodes.clear();
+  levels.clear();
+  level_offsets.clear();
+  num_build++;
+  if (num == 0) {
+    return;
+  }
+  nodes.reserve(num / LEAF_SIZE * 2 + 1);
+  nodes.push_back(Node());
+  stack.push_back({ 0, 0, num, 0 });
+  while (!stack.empty()) {
+    Task task = stack.back();
+    stack.pop_back();
+    Node& node = nodes[task.node];
+    node.left  = -1;
+    node.first = task.first;
+    node.count = task.count;
+    if (task.count <= LEAF_SIZE) {
+      continue;
+    }
+    Vec3 lo(std::numeric_limits<Real>::max()), hi(std::numeric_limits<Real>::lowest());
+    for(int k = task.first; k < task.first + task.count; k++) {
+      lo = glm::min(lo, centroid[tris[k]]);
+      hi = glm::max(hi, centroid[tris[k]]);
+    }
+    Vec3 extent = hi - lo;
+    int  axis   = (extent.x >= extent.y) ? ((extent.x >= extent.z) ? 0 : 2) : ((extent.y >= extent.z) ? 1 : 2);
+    int  half   = task.count / 2;
+    std::nth_element(tris.begin() + task.first, tris.begin() + task.first + half, tris.begin() + task.first + task.count,
+                     [&](int a, int b) { return centroid[a][axis] < centroid[b][axis]; });
+    int left   = (int)nodes.size();
+    node.left  = left;
+    node.count = 0;
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    depth.push_back(task.depth + 1);
+    depth.push_back(task.depth + 1);
+    stack.push_back({ left,     task.first,        half,              task.depth + 1 });
+    stack.push_back({ left + 1, task.first + half, task.count - half, task.depth + 1 });
+  }
+  int max_depth = *std::max_element(depth.begin(), depth.end());
+  level_offsets.assign(max_depth + 2, 0);
+  for(int d : depth) {
+    level_offsets[d + 1]++;
+  }
+  for(int d = 0; d <= max_depth; d++) {
+    level_offsets[d + 1] += level_offsets[d];
+  }
+  levels.resize(nodes.size());
+  std::vector<int> cursor(level_offsets.begin(), level_offsets.end() - 1);
+  for(int n = 0; n < (int)nodes.size(); n++) {
+    levels[cursor[depth[n]]++] = n;
+  }
+  build_area = (Real)0.0; // no rebuild check on the first refit
+  Refit(nullptr, points, triangles);
+  build_area = area;
+}
+
+template<typename Real>
+bool TriangleBVH<Real>::Refit(ThreadPool* pool, const Points<Real>& points, const std::vector<std::uint32_t>& triangles) {
+  const int MIN_GRAIN = 256;
+  if (nodes.empty() || (tris.size() * 3 != triangles.size())) {
+    Build(points, triangles);
+    return true;
+  }
+  area = (Real)0.0;
+  for(int d = (int)level_offsets.size() - 2; d >= 0; d--) { // children before parents
+    area += ParallelReduce(pool, level_offsets[d], level_offsets[d + 1], MIN_GRAIN, (Real)0.0, [&](int begin, int end) {
+      Real sum = (Real)0.0;
+      for(int k = begin; k < end; k++) {
+        Node& node = nodes[levels[k]];
+        if (node.left < 0) {
+          node.lo = Vec3(std::numeric_limits<Real>::max());
+          node.hi = Vec3(std::numeric_limits<Real>::lowest());
+          for(int t = node.first; t < node.first + node.count; t++) {
+            for(int c = 0; c < 3; c++) {
+              std::uint32_t p = triangles[tris[t] * 3 + c];
+              Vec3          x = points.Position(p);
+              node.lo = glm::min(node.lo, x);
+              node.hi = glm::max(node.hi, x);
+              if (swept) {
+                x       = Vec3(points.prev_x[p], points.prev_y[p], points.prev_z[p]);
+                node.lo = glm::min(node.lo, x);
+                node.hi = glm::max(node.hi, x);
+              }
+            }
+          }
+        } else {
+          node.lo = glm::min(nodes[node.left].lo, nodes[node.left + 1].lo);
+          node.hi = glm::max(nodes[node.left].hi, nodes[node.left + 1].hi);
+        }
+        sum += surface_area(node.lo, node.hi);
+      }
+      return sum;
+    }, [](Real a, Real b) { return a + b; });
+  }
+  if ((build_area > (Real)0.0) && (area > build_area * (Real)REBUILD_RATIO)) {
+    Build(points, triangles);
+    return true;
+  }
+  return false;
+}
+
+template<typename Real>
+bool TriangleBVH<Real>::Raycast(const Points<Real>& points, const std::vector<std::uint32_t>& triangles, const Vec3& origin, const Vec3& dir, Real max_t, Hit& hit) const {
+  const Vec3 inv_dir = (Real)1.0 / dir;
+  int        stack[64];
+  int        top = 0;
+  Real       t_near;
+  bool       found = false;
+  if (nodes.empty() || !slab(nodes[0].lo, nodes[0].hi, origin, inv_dir, max_t, t_near)) {
+    return false;
+  }
+  stack[top++] = 0;
+  while (top > 0) {
+    const Node& node = nodes[stack[--top]];
+    if (!slab(node.lo, node.hi, origin, inv_dir, max_t, t_near)) { // max_t shrinks with every hit
+      continue;
+    }
+    if (node.left >= 0) {
+      Real t0, t1;
+      bool h0 = slab(nodes[node.left].lo,     nodes[node.left].hi,     origin, inv_dir, max_t, t0);
+      bool h1 = slab(nodes[node.left + 1].lo, nodes[node.left + 1].hi, origin, inv_dir, max_t, t1);
+      if (h0 && h1) { // nearer child on top
+        stack[top++] = (t0 < t1) ? node.left + 1 : node.left;
+        stack[top++] = (t0 < t1) ? node.left     : node.left + 1;
+      } else if (h0 || h1) {
+        stack[top++] = h0 ? node.left : node.left + 1;
+      }
+      continue;
+    }
+    for(int k = node.first; k < node.first + node.count; k++) { // Moller-Trumbore
+      const std::uint32_t* v  = &triangles[tris[k] * 3];
+      Vec3                 a  = points.Position(v[0]);
+      Vec3                 e1 = points.Position(v[1]) - a;
+      Vec3                 e2 = points.Position(v[2]) - a;
+      Vec3                 p  = glm::cross(dir, e2);
+      Real                 det = glm::dot(e1, p);
+      if (std::abs(det) < (Real)FLT_EPSILON * glm::length(e1) * glm::length(e2)) {
+        continue;
+      }
+      Vec3 s = origin - a;
+      Vec3 q = glm::cross(s, e1);
+      Real u = glm::dot(s, p) / det;
+      Real w = glm::dot(dir, q) / det;
+      Real t = glm::dot(e2, q) / det;
+      if ((u >= (Real)0.0) && (w >= (Real)0.0) && (u + w <= (Real)1.0) && (t >= (Real)0.0) && (t < max_t)) {
+        max_t    = t;
+        hit.t    = t;
+        hit.tri  = tris[k];
+        hit.bary = Vec3((Real)1.0 - u - w, u, w);
+        found    = true;
+      }
+    }
+  }
+  return found;
+}
+
+template class TriangleBVH<float>;
+template class TriangleBVH<double>;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/points.h"
+#include "core/thread_pool.h"
+
+// bounding volume hierarchy over the triangles of a deforming surface. built once top down (median split of the
+// centroids), then only refit bottom up while the points move, a level at a time with every level in parallel.
+// the summed surface area of the nodes tells how far the topology has drifted from the geometry, once it grows
+// past a ratio of the area right after the build the tree is rebuilt. a swept tree bounds every triangle over the
+// motion of the step, prev to pos, for continuous collision
+template<typename Real>
+class TriangleBVH {
+public:
+  typedef glm::vec<3, Real> Vec3;
+  static const int LEAF_SIZE = 4;
+  struct Node {
+    Vec3 lo;
+    Vec3 hi;
+    int  left;                          // children are left and left + 1, -1 : leaf
+    int  first;                         // leaf : tris[first, first + count)
+    int  count;
+  };
+  struct Hit {
+    Real t;                             // origin + dir * t
+    int  tri;
+    Vec3 bary;                          // of the triangle corners
+  };
+private:
+  std::vector<Node>          nodes;     // root first
+  std::vector<int>           tris;      // triangle indices in leaf order
+  std::vector<int>           levels;    // nodes of depth d are levels[level_offsets[d], level_offsets[d+1])
+  std::vector<int>           level_offsets;
+  Real                       build_area;
+  Real                       area;
+  int                        num_build;
+  bool                       swept;
+public:
+  explicit TriangleBVH(bool in_swept = false) : nodes(), tris(), levels(), level_offsets(), build_area((Real)0.0), area((Real)0.0), num_build(0), swept(in_swept) {}
+  bool   Empty()     const { return nodes.empty(); }
+  void   Build(const Points<Real>& points, const std::vector<std::uint32_t>& triangles);
+  // new bounds for the current points, rebuilds instead when the tree has degraded. true if it rebuilt
+  bool   Refit(ThreadPool* pool, const Points<Real>& points, const std::vector<std::uint32_t>& triangles);
+  // nearest triangle hit by origin + dir * t, 0 <= t < max_t
+  bool   Raycast(const Points<Real>& points, const std::vector<std::uint32_t>& triangles, const Vec3& origin, const Vec3& dir, Real max_t, Hit& hit) const;
+  // func(tri) for every triangle whose node box overlaps [lo, hi]
+  template<typename F>
+  void   Query(const Vec3& lo, const Vec3& hi, F&& func) const {
+    int stack[64];
+    int top = 0;
+    if (!nodes.empty()) {
+      stack[top++] = 0;
+    }
+    while (top > 0) {
+      const Node& node = nodes[stack[--top]];
+      if (glm::any(glm::lessThan(node.hi, lo)) || glm::any(glm::lessThan(hi, node.lo))) {
+        continue;
+      }
+      if (node.left < 0) {
+        for(int k = node.first; k < node.first + node.count; k++) {
+          func(tris[k]);
+        }
+      } else {
+        stack[top++] = node.left;
+        stack[top++] = node.left + 1;
+      }
+    }
+  }
+  // summed node area over the area right after the last build, 1 : as good as new
+  Real   Quality()   const { return (build_area > (Real)0.0) ? area / build_area : (Real)1.0; }
+  int    NumBuild()  const { return num_build; }
+  int    NumNodes()  const { return (int)nodes.size(); }
+  const std::vector<Node>& GetNodes() const { return nodes; }
+};
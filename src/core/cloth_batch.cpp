@@ -0,0 +1,359 @@
+#include "core/cloth_batch.h"
+#include "core/scene_cloth.h"
+#include "core/simd.h"
+#include <cmath>
+
+ClothBatch::ClothBatch(const Vec2& width, const glm::ivec2& in_div, const Vec3& in_pos, int in_num_instance, const Params& params) : num_instance(std::max(in_num_instance, 1)), num_block(0), num_point(0), distance_end(), constraints(), bends(), triangles(), points(), lambdas(), compliance(), num_iteration() {
+  SceneCloth<Float>    prototype(width, in_div, in_pos); // topology and rest state, constraints come out sorted by color
+  const Points<Float>& src = prototype.GetPoints();
+  num_block   = (num_instance + LANES - 1) / LANES;
+  num_point   = src.Size();
+  constraints = prototype.GetConstraints();
+  bends       = prototype.GetBends();
+  for(int t = 0; t < eConstraint_Bend; t++) {
+    distance_end[t] = prototype.GetBatch(t).end;
+  }
+  triangles   = prototype.GetTriangles();
+  points.Reserve(num_block * num_point * LANES);
+  for(int b = 0; b < num_block; b++) {
+    for(int i = 0; i < num_point; i++) {
+      for(int l = 0; l < LANES; l++) {
+        bool padding = (b * LANES + l) >= num_instance;
+        points.Add(padding ? (Float)0.0 : src.inv_mass[i], src.Position(i), Vec3((Float)0.0)); // padding lanes never move
+      }
+    }
+  }
+  lambdas.assign((std::size_t)num_block * NumLambdas() * LANES, (Float)0.0);
+  compliance.assign(num_block * LANES, (Float)params.compliance);
+  num_iteration.assign(num_block * LANES, 0);
+  std::fill(num_iteration.begin(), num_iteration.begin() + num_instance, std::max(params.num_iteration, 1));
+}
+
+ClothBatch::~ClothBatch() {
+  points.Clear();
+  constraints.clear();
+  constraints.shrink_to_fit();
+  bends.clear();
+  bends.shrink_to_fit();
+  triangles.clear();
+  triangles.shrink_to_fit();
+  lambdas.clear();
+  lambdas.shrink_to_fit();
+  compliance.clear();
+  compliance.shrink_to_fit();
+  num_iteration.clear();
+  num_iteration.shrink_to_fit();
+}
+
+namespace {
+  static_assert(ClothBatch::LANES == 8, "lane kernels below assume 8 instances per block");
+
+  // eq.17/eq.18 for one constraint across the 8 lanes of a block, lanes are contiguous so no gathers are needed
+#if defined(XPBD_AVX2)
+XPBD_AVX2_BEGIN
+  namespace avx2 {
+    inline void SolveLanes(float* px, float* py, float* pz, const float* im, std::size_t i0, std::size_t i1, float rest, float* lambda, const float* alpha, const float* active) {
+      const __m256 eps = _mm256_set1_ps(FLT_EPSILON);
+      const __m256 va  = _mm256_loadu_ps(alpha);
+      __m256 w0  = _mm256_loadu_ps(im + i0);
+      __m256 w1  = _mm256_loadu_ps(im + i1);
+      __m256 vx0 = _mm256_loadu_ps(px + i0);
+      __m256 vy0 = _mm256_loadu_ps(py + i0);
+      __m256 vz0 = _mm256_loadu_ps(pz + i0);
+      __m256 vx1 = _mm256_loadu_ps(px + i1);
+      __m256 vy1 = _mm256_loadu_ps(py + i1);
+      __m256 vz1 = _mm256_loadu_ps(pz + i1);
+      __m256 gx  = _mm256_sub_ps(vx0, vx1);
+      __m256 gy  = _mm256_sub_ps(vy0, vy1);
+      __m256 gz  = _mm256_sub_ps(vz0, vz1);
+      __m256 d   = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gy, gy)), _mm256_mul_ps(gz, gz)));
+      __m256 w   = _mm256_add_ps(w0, w1);
+      __m256 lam = _mm256_loadu_ps(lambda);
+      __m256 cj  = _mm256_sub_ps(d, _mm256_set1_ps(rest));                                                    // Cj(x)
+      __m256 dl  = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), cj), _mm256_mul_ps(va, lam)),
+                                 _mm256_add_ps(w, va));                                                       // eq.18
+      dl         = _mm256_and_ps(_mm256_mul_ps(dl, _mm256_loadu_ps(active)), _mm256_cmp_ps(w, eps, _CMP_GE_OQ));
+      _mm256_storeu_ps(lambda, _mm256_add_ps(lam, dl));
+      __m256 s   = _mm256_div_ps(dl, _mm256_add_ps(d, eps));                                                 // eq.17
+      __m256 cx  = _mm256_mul_ps(s, gx);
+      __m256 cy  = _mm256_mul_ps(s, gy);
+      __m256 cz  = _mm256_mul_ps(s, gz);
+      _mm256_storeu_ps(px + i0, _mm256_add_ps(vx0, _mm256_mul_ps(cx, w0)));
+      _mm256_storeu_ps(py + i0, _mm256_add_ps(vy0, _mm256_mul_ps(cy, w0)));
+      _mm256_storeu_ps(pz + i0, _mm256_add_ps(vz0, _mm256_mul_ps(cz, w0)));
+      _mm256_storeu_ps(px + i1, _mm256_sub_ps(vx1, _mm256_mul_ps(cx, w1)));
+      _mm256_storeu_ps(py + i1, _mm256_sub_ps(vy1, _mm256_mul_ps(cy, w1)));
+      _mm256_storeu_ps(pz + i1, _mm256_sub_ps(vz1, _mm256_mul_ps(cz, w1)));
+    }
+    // the same for one hinge, idx/k are the hinge points (already scaled by LANES) and stencil, lambda its three axes
+    inline void SolveBendLanes(float* px, float* py, float* pz, const float* im, const std::size_t* idx, const float* k, float* lambda, const float* alpha, const float* active) {
+      const __m256 eps = _mm256_set1_ps(FLT_EPSILON);
+      const __m256 va  = _mm256_loadu_ps(alpha);
+      __m256 w[4], x[4], y[4], z[4], vk[4];
+      __m256 vx = _mm256_setzero_ps(), vy = _mm256_setzero_ps(), vz = _mm256_setzero_ps(), sum_w = _mm256_setzero_ps();
+      for (int j = 0; j < 4; j++) {
+        vk[j] = _mm256_set1_ps(k[j]);
+        w[j]  = _mm256_loadu_ps(im + idx[j]);
+        x[j]  = _mm256_loadu_ps(px + idx[j]);
+        y[j]  = _mm256_loadu_ps(py + idx[j]);
+        z[j]  = _mm256_loadu_ps(pz + idx[j]);
+        vx    = _mm256_add_ps(vx, _mm256_mul_ps(vk[j], x[j]));
+        vy    = _mm256_add_ps(vy, _mm256_mul_ps(vk[j], y[j]));
+        vz    = _mm256_add_ps(vz, _mm256_mul_ps(vk[j], z[j]));
+        sum_w = _mm256_add_ps(sum_w, _mm256_mul_ps(w[j], _mm256_mul_ps(vk[j], vk[j])));
+      }
+      __m256 v[3] = { vx, vy, vz }, dl[3];
+      __m256 den  = _mm256_add_ps(sum_w, va);
+      __m256 act  = _mm256_loadu_ps(active);
+      __m256 live = _mm256_cmp_ps(sum_w, eps, _CMP_GE_OQ);
+      for (int d = 0; d < 3; d++) { // lambda : the 8 lanes of each axis
+        __m256 lam = _mm256_loadu_ps(lambda + d * 8);
+        dl[d]      = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), v[d]), _mm256_mul_ps(va, lam)), den); // eq.18
+        dl[d]      = _mm256_and_ps(_mm256_mul_ps(dl[d], act), live);
+        _mm256_storeu_ps(lambda + d * 8, _mm256_add_ps(lam, dl[d]));
+      }
+      for (int j = 0; j < 4; j++) {
+        __m256 f = _mm256_mul_ps(w[j], vk[j]);                                                                 // eq.17
+        _mm256_storeu_ps(px + idx[j], _mm256_add_ps(x[j], _mm256_mul_ps(f, dl[0])));
+        _mm256_storeu_ps(py + idx[j], _mm256_add_ps(y[j], _mm256_mul_ps(f, dl[1])));
+        _mm256_storeu_ps(pz + idx[j], _mm256_add_ps(z[j], _mm256_mul_ps(f, dl[2])));
+      }
+    }
+    // SolveDistances and SolveBends below over the 8 wide kernels
+    void SolveDistances(float* px, float* py, float* pz, const float* im, const DistanceConstraint<float>* c, int count, float* lambda, const float* alpha, const float* active) {
+      for(int i = 0; i < count; i++) {
+        SolveLanes(px, py, pz, im, (std::size_t)c[i].idx0 * ClothBatch::LANES, (std::size_t)c[i].idx1 * ClothBatch::LANES, c[i].rest_length,
+                   &lambda[i * ClothBatch::LANES], alpha, active);
+      }
+    }
+    void SolveBends(float* px, float* py, float* pz, const float* im, const DihedralConstraint<float>* c, int count, float* lambda, const float* alpha, const float* active) {
+      for(int i = 0; i < count; i++) {
+        std::size_t idx[4];
+        for(int j = 0; j < 4; j++) {
+          idx[j] = (std::size_t)c[i].idx[j] * ClothBatch::LANES;
+        }
+        SolveBendLanes(px, py, pz, im, idx, c[i].k, &lambda[i * DihedralConstraint<float>::NUM_LAMBDA * ClothBatch::LANES], alpha, active);
+      }
+    }
+  };
+XPBD_AVX2_END
+#endif
+#if defined(XPBD_SSE2)
+  inline void SolveLanes(float* px, float* py, float* pz, const float* im, std::size_t i0, std::size_t i1, float rest, float* lambda, const float* alpha, const float* active) {
+    const __m128 eps = _mm_set1_ps(FLT_EPSILON);
+    for (int l = 0; l < 8; l += 4, i0 += 4, i1 += 4) {
+      __m128 va  = _mm_loadu_ps(alpha + l);
+      __m128 w0  = _mm_loadu_ps(im + i0);
+      __m128 w1  = _mm_loadu_ps(im + i1);
+      __m128 vx0 = _mm_loadu_ps(px + i0);
+      __m128 vy0 = _mm_loadu_ps(py + i0);
+      __m128 vz0 = _mm_loadu_ps(pz + i0);
+      __m128 vx1 = _mm_loadu_ps(px + i1);
+      __m128 vy1 = _mm_loadu_ps(py + i1);
+      __m128 vz1 = _mm_loadu_ps(pz + i1);
+      __m128 gx  = _mm_sub_ps(vx0, vx1);
+      __m128 gy  = _mm_sub_ps(vy0, vy1);
+      __m128 gz  = _mm_sub_ps(vz0, vz1);
+      __m128 d   = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)), _mm_mul_ps(gz, gz)));
+      __m128 w   = _mm_add_ps(w0, w1);
+      __m128 lam = _mm_loadu_ps(lambda + l);
+      __m128 cj  = _mm_sub_ps(d, _mm_set1_ps(rest));                                                       // Cj(x)
+      __m128 dl  = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), cj), _mm_mul_ps(va, lam)),
+                              _mm_add_ps(w, va));                                                          // eq.18
+      dl         = _mm_and_ps(_mm_mul_ps(dl, _mm_loadu_ps(active + l)), _mm_cmpge_ps(w, eps));
+      _mm_storeu_ps(lambda + l, _mm_add_ps(lam, dl));
+      __m128 s   = _mm_div_ps(dl, _mm_add_ps(d, eps));                                                    // eq.17
+      __m128 cx  = _mm_mul_ps(s, gx);
+      __m128 cy  = _mm_mul_ps(s, gy);
+      __m128 cz  = _mm_mul_ps(s, gz);
+      _mm_storeu_ps(px + i0, _mm_add_ps(vx0, _mm_mul_ps(cx, w0)));
+      _mm_storeu_ps(py + i0, _mm_add_ps(vy0, _mm_mul_ps(cy, w0)));
+      _mm_storeu_ps(pz + i0, _mm_add_ps(vz0, _mm_mul_ps(cz, w0)));
+      _mm_storeu_ps(px + i1, _mm_sub_ps(vx1, _mm_mul_ps(cx, w1)));
+      _mm_storeu_ps(py + i1, _mm_sub_ps(vy1, _mm_mul_ps(cy, w1)));
+      _mm_storeu_ps(pz + i1, _mm_sub_ps(vz1, _mm_mul_ps(cz, w1)));
+    }
+  }
+  inline void SolveBendLanes(float* px, float* py, float* pz, const float* im, const std::size_t* idx, const float* k, float* lambda, const float* alpha, const float* active) {
+    const __m128 eps = _mm_set1_ps(FLT_EPSILON);
+    for (int l = 0; l < 8; l += 4) {
+      __m128 va = _mm_loadu_ps(alpha + l);
+      __m128 w[4], x[4], y[4], z[4], vk[4];
+      __m128 vx = _mm_setzero_ps(), vy = _mm_setzero_ps(), vz = _mm_setzero_ps(), sum_w = _mm_setzero_ps();
+      for (int j = 0; j < 4; j++) {
+        vk[j] = _mm_set1_ps(k[j]);
+        w[j]  = _mm_loadu_ps(im + idx[j] + l);
+        x[j]  = _mm_loadu_ps(px + idx[j] + l);
+        y[j]  = _mm_loadu_ps(py + idx[j] + l);
+        z[j]  = _mm_loadu_ps(pz + idx[j] + l);
+        vx    = _mm_add_ps(vx, _mm_mul_ps(vk[j], x[j]));
+        vy    = _mm_add_ps(vy, _mm_mul_ps(vk[j], y[j]));
+        vz    = _mm_add_ps(vz, _mm_mul_ps(vk[j], z[j]));
+        sum_w = _mm_add_ps(sum_w, _mm_mul_ps(w[j], _mm_mul_ps(vk[j], vk[j])));
+      }
+      __m128 v[3] = { vx, vy, vz }, dl[3];
+      __m128 den  = _mm_add_ps(sum_w, va);
+      __m128 act  = _mm_loadu_ps(active + l);
+      __m128 live = _mm_cmpge_ps(sum_w, eps);
+      for (int d = 0; d < 3; d++) { // lambda : the 8 lanes of each axis
+        __m128 lam = _mm_loadu_ps(lambda + d * 8 + l);
+        dl[d]      = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), v[d]), _mm_mul_ps(va, lam)), den);  // eq.18
+        dl[d]      = _mm_and_ps(_mm_mul_ps(dl[d], act), live);
+        _mm_storeu_ps(lambda + d * 8 + l, _mm_add_ps(lam, dl[d]));
+      }
+      for (int j = 0; j < 4; j++) {
+        __m128 f = _mm_mul_ps(w[j], vk[j]);                                                              // eq.17
+        _mm_storeu_ps(px + idx[j] + l, _mm_add_ps(x[j], _mm_mul_ps(f, dl[0])));
+        _mm_storeu_ps(py + idx[j] + l, _mm_add_ps(y[j], _mm_mul_ps(f, dl[1])));
+        _mm_storeu_ps(pz + idx[j] + l, _mm_add_ps(z[j], _mm_mul_ps(f, dl[2])));
+      }
+    }
+  }
+#else
+  inline void SolveLanes(Float* px, Float* py, Float* pz, const Float* im, std::size_t i0, std::size_t i1, Float rest, Float* lambda, const Float* alpha, const Float* active) {
+    for (int l = 0; l < ClothBatch::LANES; l++) {
+      Float w0      = im[i0 + l];
+      Float w1      = im[i1 + l];
+      Float dx      = px[i0 + l] - px[i1 + l];
+      Float dy      = py[i0 + l] - py[i1 + l];
+      Float dz      = pz[i0 + l] - pz[i1 + l];
+      Float d       = std::sqrt(dx * dx + dy * dy + dz * dz);
+      Float wsum    = w0 + w1;
+      if (wsum < FLT_EPSILON) {
+        continue;
+      }
+      Float dlambda = (-(d - rest) - alpha[l] * lambda[l]) / (wsum + alpha[l]) * active[l]; // eq.18
+      lambda[l]    += dlambda;
+      Float s       = dlambda / (d + FLT_EPSILON);                                           // eq.17
+      px[i0 + l] += dx * s * w0; py[i0 + l] += dy * s * w0; pz[i0 + l] += dz * s * w0;
+      px[i1 + l] -= dx * s * w1; py[i1 + l] -= dy * s * w1; pz[i1 + l] -= dz * s * w1;
+    }
+  }
+  inline void SolveBendLanes(Float* px, Float* py, Float* pz, const Float* im, const std::size_t* idx, const Float* k, Float* lambda, const Float* alpha, const Float* active) {
+    for (int l = 0; l < ClothBatch::LANES; l++) {
+      Float vx = (Float)0.0, vy = (Float)0.0, vz = (Float)0.0, sum_w = (Float)0.0;
+      for (int j = 0; j < 4; j++) {
+        vx    += k[j] * px[idx[j] + l];
+        vy    += k[j] * py[idx[j] + l];
+        vz    += k[j] * pz[idx[j] + l];
+        sum_w += im[idx[j] + l] * k[j] * k[j];
+      }
+      if (sum_w < FLT_EPSILON) {
+        continue;
+      }
+      Float dl[3], v[3] = { vx, vy, vz };
+      for (int d = 0; d < 3; d++) { // lambda : the lanes of each axis
+        Float& lam = lambda[d * ClothBatch::LANES + l];
+        dl[d]      = (-v[d] - alpha[l] * lam) / (sum_w + alpha[l]) * active[l];                 // eq.18
+        lam       += dl[d];
+      }
+      for (int j = 0; j < 4; j++) {
+        Float f = im[idx[j] + l] * k[j];                                                      // eq.17
+        px[idx[j] + l] += f * dl[0]; py[idx[j] + l] += f * dl[1]; pz[idx[j] + l] += f * dl[2];
+      }
+    }
+  }
+#endif
+  // count constraints of one block from c, lambda : their lambdas. the AVX2 kernels when the cpu has them
+  void SolveDistances(Float* px, Float* py, Float* pz, const Float* im, const DistanceConstraint<Float>* c, int count, Float* lambda, const Float* alpha, const Float* active) {
+#if defined(XPBD_AVX2)
+    if (UseAvx2()) {
+      avx2::SolveDistances(px, py, pz, im, c, count, lambda, alpha, active);
+      return;
+    }
+#endif
+    for(int i = 0; i < count; i++) {
+      SolveLanes(px, py, pz, im, (std::size_t)c[i].idx0 * ClothBatch::LANES, (std::size_t)c[i].idx1 * ClothBatch::LANES, c[i].rest_length,
+                 &lambda[i * ClothBatch::LANES], alpha, active);
+    }
+  }
+  void SolveBends(Float* px, Float* py, Float* pz, const Float* im, const DihedralConstraint<Float>* c, int count, Float* lambda, const Float* alpha, const Float* active) {
+#if defined(XPBD_AVX2)
+    if (UseAvx2()) {
+      avx2::SolveBends(px, py, pz, im, c, count, lambda, alpha, active);
+      return;
+    }
+#endif
+    for(int i = 0; i < count; i++) {
+      std::size_t idx[4];
+      for(int j = 0; j < 4; j++) {
+        idx[j] = (std::size_t)c[i].idx[j] * ClothBatch::LANES;
+      }
+      SolveBendLanes(px, py, pz, im, idx, c[i].k, &lambda[i * DihedralConstraint<Float>::NUM_LAMBDA * ClothBatch::LANES], alpha, active);
+    }
+  }
+};
+
+// plain Gauss-Seidel over the shared constraint order, every lane is a different instance so lanes never depend on each other
+void ClothBatch::SolveConstraints(int block, const Params& params, const Float* alpha, int iteration, int pass) {
+  const std::size_t base   = PointBase(block);
+  Float*            lambda = &lambdas[ConstraintBase(block)];
+  const int*        iters  = &num_iteration[block * LANES];
+  Float             active[LANES];
+  for(int l = 0; l < LANES; l++) {
+    active[l] = (iteration < iters[l]) ? (Float)1.0 : (Float)0.0; // instance already ran its iterations
+  }
+  Float* px = &points.pos_x[base];
+  Float* py = &points.pos_y[base];
+  Float* pz = &points.pos_z[base];
+  Float* im = &points.inv_mass[base];
+  for(int t = 0; t < eConstraint_Bend; t++) {
+    int begin = (t == 0) ? 0 : distance_end[t - 1];
+    if (params.batch[t].Solve(pass)) {
+      SolveDistances(px, py, pz, im, &constraints[begin], distance_end[t] - begin, &lambda[begin * LANES], &alpha[t * LANES], active);
+    }
+  }
+  if (params.batch[eConstraint_Bend].Solve(pass)) {
+    SolveBends(px, py, pz, im, bends.data(), (int)bends.size(), &lambda[constraints.size() * LANES], &alpha[eConstraint_Bend * LANES], active);
+  }
+}
+
+void ClothBatch::BlockAlpha(int block, const Params& params, Float h, Float* alpha) const {
+  for(int t = 0; t <= eConstraint_Bend; t++) {
+    for(int l = 0; l < LANES; l++) {
+      Float value = (params.batch[t].compliance < 0.0f) ? compliance[block * LANES + l] : (Float)params.batch[t].compliance;
+      alpha[t * LANES + l] = value / (h * h); // a~
+    }
+  }
+}
+
+void ClothBatch::UpdateBlock(int block, const Params& params, Float dt) {
+  const int begin = (int)PointBase(block);
+  const int end   = (int)PointBase(block + 1);
+  Float     alpha[(eConstraint_Bend + 1) * LANES];
+  auto      lambda_init = [&]() { std::fill(lambdas.begin() + ConstraintBase(block), lambdas.begin() + ConstraintBase(block + 1), (Float)0.0); };
+  if (params.integrator == eIntegrator_Substep) {
+    int   num_substep = std::max(params.num_substep, 1);
+    Float h           = dt / (Float)num_substep;
+    BlockAlpha(block, params, h, alpha);
+    for(int i = 0; i < num_substep; i++) {
+      points.Integrate(h, begin, end);
+      lambda_init(); // reset every substep
+      SolveConstraints(block, params, alpha, 0, i); // batch intervals count substeps
+      points.UpdateVelocity(h, begin, end);
+    }
+  } else {
+    BlockAlpha(block, params, dt, alpha);
+    points.Predict(dt, begin, end);
+    lambda_init(); // reset every time frame
+    int num = *std::max_element(num_iteration.begin() + block * LANES, num_iteration.begin() + (block + 1) * LANES);
+    for(int i = 0; i < num; i++) {
+      SolveConstraints(block, params, alpha, i, i);
+    }
+  }
+}
+
+void ClothBatch::Update(const Params& params, Float dt) {
+  ParallelFor(params.thread_pool, 0, num_block, 1, [&](int begin, int end) {
+    for(int b = begin; b < end; b++) {
+      UpdateBlock(b, params, dt);
+    }
+  });
+}
+
+void ClothBatch::GetPositions(int instance, std::vector<Vec3>& out) const {
+  out.resize(num_point);
+  for(int i = 0; i < num_point; i++) {
+    out[i] = Position(instance, i);
+  }
+}
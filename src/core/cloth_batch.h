@@ -0,0 +1,57 @@
+#pragma once
+
+#include "core/scene.h"
+#include "core/constraint.h"
+#include "core/thread_pool.h"
+
+// many instances of one cloth topology stepped together.
+// instances are packed LANES at a time into blocks, every stream is laid out [block][point][lane]
+// so one constraint is projected for all lanes of a block with contiguous loads and no gathers.
+// blocks are independent and are distributed over the thread pool. float only, the lane kernels are single precision
+class ClothBatch {
+public:
+  static const int LANES = 8;
+private:
+  int                                    num_instance;
+  int                                    num_block;
+  int                                    num_point;     // per instance
+  int                                    distance_end[eConstraint_Bend]; // end of each type in constraints
+  std::vector<DistanceConstraint<Float>> constraints;   // shared topology, idx0/idx1 index a point of one instance
+  std::vector<DihedralConstraint<Float>> bends;         // solved after all distance constraints
+  std::vector<std::uint32_t>             triangles;
+  Points<Float>                          points;        // [block][point][lane]
+  AlignedVector<Float>                   lambdas;       // [block][constraint][lane], a hinge has one per axis
+  AlignedVector<Float>                   compliance;    // [block][lane]
+  std::vector<int>                       num_iteration; // [block][lane], 0 : padding lane
+  std::size_t PointBase(int block)      const { return (std::size_t)block * num_point * LANES; }
+  std::size_t ConstraintBase(int block) const { return (std::size_t)block * NumLambdas() * LANES; }
+  int         NumLambdas()              const { return (int)(constraints.size() + bends.size() * DihedralConstraint<Float>::NUM_LAMBDA); }
+  // pass : what BatchParams::Solve checks, iteration : what the per instance iteration counts check
+  void   SolveConstraints(int block, const Params& params, const Float* alpha, int iteration, int pass);
+  // a~ of every cloth constraint type and lane for time step h, alpha[type * LANES + lane]
+  void   BlockAlpha(int block, const Params& params, Float h, Float* alpha) const;
+  void   UpdateBlock(int block, const Params& params, Float dt);
+public:
+  // every instance starts as the SceneCloth(width, in_div, in_pos) cloth with params compliance and iterations
+  ClothBatch(const Vec2& width, const glm::ivec2& in_div, const Vec3& in_pos, int in_num_instance, const Params& params);
+  ~ClothBatch();
+  // params supplies the pool, integrator and substep count, compliance and iterations are per instance.
+  // a BatchParams compliance >= 0 overrides the instance compliance of its type, and BatchParams::Solve picks the passes
+  // of every type like in SceneCloth. eIntegrator_Iteration runs each instance for its own iteration count,
+  // eIntegrator_Substep does one pass per substep.
+  void   Update(const Params& params, Float dt);
+  void   SetCompliance(int instance, Float value)  { compliance[instance]    = value; }
+  void   SetNumIteration(int instance, int value)  { num_iteration[instance] = std::max(value, 1); }
+  Float  GetCompliance(int instance)         const { return compliance[instance]; }
+  int    GetNumIteration(int instance)       const { return num_iteration[instance]; }
+  int    NumInstances()   const { return num_instance; }
+  int    NumPoints()      const { return num_point; }
+  int    NumConstraints() const { return (int)(constraints.size() + bends.size()); }
+  Vec3   Position(int instance, int point) const {
+    std::size_t i = PointBase(instance / LANES) + (std::size_t)point * LANES + instance % LANES;
+    return points.Position((int)i);
+  }
+  // copies one instance out, e.g. for export
+  void   GetPositions(int instance, std::vector<Vec3>& out) const;
+  const std::vector<std::uint32_t>& GetTriangles() const { return triangles; }
+};
@@ -0,0 +1,351 @@
+#include "core/collider.h"
+#include "core/simd.h"
+#include <algorithm>
+#include <limits>
+
+void Colliders::AddPlane(const glm::vec4& eq) {
+  float len = glm::length(glm::vec3(eq));
+  if (len > FLT_EPSILON) {
+    planes.push_back({ glm::vec3(eq) / len, eq.w / len });
+  }
+}
+
+namespace {
+  // signed distance of x to a collider surface and the unit normal pointing out of it
+  template<typename Real>
+  Real Distance(const Colliders::Plane& c, const glm::vec<3, Real>& x, glm::vec<3, Real>& n) {
+    n = glm::vec<3, Real>(c.normal);
+    return glm::dot(n, x) + (Real)c.offset;
+  }
+
+  template<typename Real>
+  Real Distance(const Colliders::Sphere& c, const glm::vec<3, Real>& x, glm::vec<3, Real>& n) {
+    glm::vec<3, Real> diff = x - glm::vec<3, Real>(c.center);
+    Real              len  = glm::length(diff);
+    n = diff / std::max(len, (Real)FLT_EPSILON);
+    return len - (Real)c.radius;
+  }
+
+  template<typename Real>
+  Real Distance(const Colliders::Capsule& c, const glm::vec<3, Real>& x, glm::vec<3, Real>& n) {
+    glm::vec<3, Real> p0   = glm::vec<3, Real>(c.p0);
+    glm::vec<3, Real> axis = glm::vec<3, Real>(c.p1) - p0;
+    Real              t    = glm::clamp(glm::dot(x - p0, axis) / std::max(glm::dot(axis, axis), (Real)FLT_EPSILON), (Real)0.0, (Real)1.0);
+    glm::vec<3, Real> diff = x - (p0 + axis * t);
+    Real              len  = glm::length(diff);
+    n = diff / std::max(len, (Real)FLT_EPSILON);
+    return len - (Real)c.radius;
+  }
+
+  // outside : distance to the closest surface point. inside : the least negative face distance, out through that face
+  template<typename Real>
+  Real Distance(const Colliders::Box& c, const glm::vec<3, Real>& x, glm::vec<3, Real>& n) {
+    glm::vec<3, Real> q, e, o, local((Real)0.0);
+    for(int k = 0; k < 3; k++) {
+      q[k] = glm::dot(glm::vec<3, Real>(c.axes[k]), x - glm::vec<3, Real>(c.center));
+      e[k] = std::abs(q[k]) - (Real)c.half[k];
+      o[k] = std::max(e[k], (Real)0.0);
+    }
+    Real d = glm::length(o);
+    if (d > (Real)0.0) {
+      for(int k = 0; k < 3; k++) {
+        local[k] = std::copysign(o[k] / d, q[k]);
+      }
+    } else {
+      int face = (e[0] >= e[1]) ? ((e[0] >= e[2]) ? 0 : 2) : ((e[1] >= e[2]) ? 1 : 2);
+      d           = e[face];
+      local[face] = std::copysign((Real)1.0, q[face]);
+    }
+    n = glm::vec<3, Real>(c.axes[0]) * local[0] + glm::vec<3, Real>(c.axes[1]) * local[1] + glm::vec<3, Real>(c.axes[2]) * local[2];
+    return d;
+  }
+
+  // C = d - thickness >= 0 with zero compliance : move the point out along n, then cancel the tangential motion of
+  // the step up to friction * penetration (static while the tangential motion is below it). returns the penetration
+  template<typename Real, typename Shape>
+  Real Collide(const Shape& shape, Points<Real>& points, int begin, int end, Real thickness, Real friction) {
+    typedef glm::vec<3, Real> Vec3;
+    Real depth = (Real)0.0;
+    for(int i = begin; i < end; i++) {
+      if (points.inv_mass[i] < FLT_EPSILON) {
+        continue;
+      }
+      Vec3 x = points.Position(i);
+      Vec3 n;
+      Real pen = thickness - Distance(shape, x, n);
+      if (pen <= (Real)0.0) {
+        continue;
+      }
+      depth = std::max(depth, pen);
+      x += n * pen;
+      Vec3 disp = x - Vec3(points.prev_x[i], points.prev_y[i], points.prev_z[i]);
+      Vec3 t    = disp - n * glm::dot(disp, n);
+      Real len  = glm::length(t);
+      if (len > (Real)FLT_EPSILON) {
+        x -= t * std::min(friction * pen / len, (Real)1.0);
+      }
+      points.pos_x[i] = x.x;
+      points.pos_y[i] = x.y;
+      points.pos_z[i] = x.z;
+    }
+    return depth;
+  }
+
+  template<typename Real>
+  Real CollideRange(const Colliders::Plane& c, Points<Real>& points, int begin, int end, Real thickness, Real friction)   { return Collide(c, points, begin, end, thickness, friction); }
+  template<typename Real>
+  Real CollideRange(const Colliders::Sphere& c, Points<Real>& points, int begin, int end, Real thickness, Real friction)  { return Collide(c, points, begin, end, thickness, friction); }
+  template<typename Real>
+  Real CollideRange(const Colliders::Capsule& c, Points<Real>& points, int begin, int end, Real thickness, Real friction) { return Collide(c, points, begin, end, thickness, friction); }
+  template<typename Real>
+  Real CollideRange(const Colliders::Box& c, Points<Real>& points, int begin, int end, Real thickness, Real friction)     { return Collide(c, points, begin, end, thickness, friction); }
+
+  // bounding box of points[begin, end)
+  template<typename Real>
+  void Bounds(const Points<Real>& points, int begin, int end, glm::vec3& lo, glm::vec3& hi) {
+    glm::vec<3, Real> l(std::numeric_limits<Real>::max()), h(std::numeric_limits<Real>::lowest());
+    for(int i = begin; i < end; i++) {
+      l = glm::min(l, points.Position(i));
+      h = glm::max(h, points.Position(i));
+    }
+    lo = glm::vec3(l);
+    hi = glm::vec3(h);
+  }
+
+  // false when no point inside [lo, hi] can be within thickness of the collider
+  bool Touches(const Colliders::Plane& c, const glm::vec3& lo, const glm::vec3& hi, float thickness) {
+    glm::vec3 center = (lo + hi) * 0.5f, half = (hi - lo) * 0.5f;
+    return glm::dot(c.normal, center) + c.offset - glm::dot(glm::abs(c.normal), half) < thickness;
+  }
+
+  bool Touches(const Colliders::Sphere& c, const glm::vec3& lo, const glm::vec3& hi, float thickness) {
+    glm::vec3 diff = glm::clamp(c.center, lo, hi) - c.center;
+    float     r    = c.radius + thickness;
+    return glm::dot(diff, diff) < r * r;
+  }
+
+  bool Touches(const Colliders::Capsule& c, const glm::vec3& lo, const glm::vec3& hi, float thickness) {
+    glm::vec3 r(c.radius + thickness);
+    return glm::all(glm::lessThan(glm::min(c.p0, c.p1) - r, hi)) && glm::all(glm::lessThan(lo, glm::max(c.p0, c.p1) + r));
+  }
+
+  bool Touches(const Colliders::Box& c, const glm::vec3& lo, const glm::vec3& hi, float thickness) {
+    glm::vec3 ext = glm::abs(c.axes[0]) * c.half.x + glm::abs(c.axes[1]) * c.half.y + glm::abs(c.axes[2]) * c.half.z + glm::vec3(thickness);
+    return glm::all(glm::lessThan(c.center - ext, hi)) && glm::all(glm::lessThan(lo, c.center + ext));
+  }
+
+  // bounding box of the motion of points[begin, end)
+  template<typename Real>
+  void SweptBounds(const Points<Real>& points, int begin, int end, glm::vec3& lo, glm::vec3& hi) {
+    glm::vec<3, Real> l(std::numeric_limits<Real>::max()), h(std::numeric_limits<Real>::lowest());
+    for(int i = begin; i < end; i++) {
+      glm::vec<3, Real> x0(points.prev_x[i], points.prev_y[i], points.prev_z[i]);
+      l = glm::min(l, glm::min(x0, points.Position(i)));
+      h = glm::max(h, glm::max(x0, points.Position(i)));
+    }
+    lo = glm::vec3(l);
+    hi = glm::vec3(h);
+  }
+
+  // first t along x0 -> x1 within thickness of the shape and the normal there, conservative advancement : the
+  // distance is a lower bound of the free path, so a step never passes the surface. false if the path stays out or
+  // starts inside the collider
+  template<typename Real, typename Shape>
+  bool FirstContact(const Shape& shape, const glm::vec<3, Real>& x0, const glm::vec<3, Real>& x1, Real thickness, Real& t, glm::vec<3, Real>& n) {
+    const int  MAX_STEP = 32;               // a path grazing the surface converges slowly, it is left to the projection
+    const Real tol      = thickness * (Real)0.1;
+    Real       len      = glm::length(x1 - x0);
+    t = (Real)0.0;
+    for(int k = 0; k < MAX_STEP; k++) {
+      Real d = Distance(shape, x0 + (x1 - x0) * t, n) - thickness;
+      if (d < tol) { // a start within the thickness counts as a contact at 0, only a start inside the collider does not
+        return (k > 0) || (d + thickness >= (Real)0.0);
+      }
+      t += d / len;
+      if (t > (Real)1.0) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // earliest stop of every point of [begin, end) against one shape, t[i - begin] < 1 : stop at prev + (pos - prev) * t
+  template<typename Real, typename Shape>
+  void SweepRange(const Shape& shape, const Points<Real>& points, int begin, int end, Real thickness, Real* t) {
+    typedef glm::vec<3, Real> Vec3;
+    for(int i = begin; i < end; i++) {
+      Vec3 x0(points.prev_x[i], points.prev_y[i], points.prev_z[i]);
+      Vec3 x1 = points.Position(i);
+      Vec3 n0, n1;
+      Real hit;
+      if ((points.inv_mass[i] < FLT_EPSILON) || (glm::dot(x1 - x0, x1 - x0) < thickness * thickness)) { // too slow to cross a shell
+        continue;
+      }
+      if (FirstContact(shape, x0, x1, thickness, hit, n0) && (hit < t[i - begin])) {
+        Distance(shape, x1, n1);
+        if (glm::dot(n0, n1) < (Real)0.0) { // the projection at x1 would push out the other side
+          t[i - begin] = hit;
+        }
+      }
+    }
+  }
+};
+
+#if defined(XPBD_SSE2)
+namespace {
+  // the collider kernels are written once (core/collider_lanes.h) over these few lane operations, 8 lanes on AVX2 and
+  // 4 on SSE2. points are contiguous so there is nothing to gather, only unaligned loads of begin + i
+#if defined(XPBD_AVX2)
+XPBD_AVX2_BEGIN
+  namespace avx2 {
+    typedef __m256 Lanes;
+    const int LANES = 8;
+    inline Lanes Set(float v)                      { return _mm256_set1_ps(v); }
+    inline Lanes Load(const float* p)              { return _mm256_loadu_ps(p); }
+    inline void  Store(float* p, Lanes v)          { _mm256_storeu_ps(p, v); }
+    inline Lanes Add(Lanes a, Lanes b)             { return _mm256_add_ps(a, b); }
+    inline Lanes Sub(Lanes a, Lanes b)             { return _mm256_sub_ps(a, b); }
+    inline Lanes Mul(Lanes a, Lanes b)             { return _mm256_mul_ps(a, b); }
+    inline Lanes Div(Lanes a, Lanes b)             { return _mm256_div_ps(a, b); }
+    inline Lanes Min(Lanes a, Lanes b)             { return _mm256_min_ps(a, b); }
+    inline Lanes Max(Lanes a, Lanes b)             { return _mm256_max_ps(a, b); }
+    inline Lanes Sqrt(Lanes a)                     { return _mm256_sqrt_ps(a); }
+    inline Lanes And(Lanes a, Lanes b)             { return _mm256_and_ps(a, b); }
+    inline Lanes AndNot(Lanes a, Lanes b)          { return _mm256_andnot_ps(a, b); } // ~a & b
+    inline Lanes Or(Lanes a, Lanes b)              { return _mm256_or_ps(a, b); }
+    inline Lanes Less(Lanes a, Lanes b)            { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline Lanes LessEqual(Lanes a, Lanes b)       { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    inline Lanes Select(Lanes m, Lanes a, Lanes b) { return _mm256_blendv_ps(b, a, m); }
+    inline bool  None(Lanes m)                     { return _mm256_movemask_ps(m) == 0; }
+    inline float HorizontalMax(Lanes v) {
+      __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+      m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+      m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+      return _mm_cvtss_f32(m);
+    }
+#include "core/collider_lanes.h"
+  };
+XPBD_AVX2_END
+#endif
+
+  namespace sse2 {
+    typedef __m128 Lanes;
+    const int LANES = 4;
+    inline Lanes Set(float v)                      { return _mm_set1_ps(v); }
+    inline Lanes Load(const float* p)              { return _mm_loadu_ps(p); }
+    inline void  Store(float* p, Lanes v)          { _mm_storeu_ps(p, v); }
+    inline Lanes Add(Lanes a, Lanes b)             { return _mm_add_ps(a, b); }
+    inline Lanes Sub(Lanes a, Lanes b)             { return _mm_sub_ps(a, b); }
+    inline Lanes Mul(Lanes a, Lanes b)             { return _mm_mul_ps(a, b); }
+    inline Lanes Div(Lanes a, Lanes b)             { return _mm_div_ps(a, b); }
+    inline Lanes Min(Lanes a, Lanes b)             { return _mm_min_ps(a, b); }
+    inline Lanes Max(Lanes a, Lanes b)             { return _mm_max_ps(a, b); }
+    inline Lanes Sqrt(Lanes a)                     { return _mm_sqrt_ps(a); }
+    inline Lanes And(Lanes a, Lanes b)             { return _mm_and_ps(a, b); }
+    inline Lanes AndNot(Lanes a, Lanes b)          { return _mm_andnot_ps(a, b); } // ~a & b
+    inline Lanes Or(Lanes a, Lanes b)              { return _mm_or_ps(a, b); }
+    inline Lanes Less(Lanes a, Lanes b)            { return _mm_cmplt_ps(a, b); }
+    inline Lanes LessEqual(Lanes a, Lanes b)       { return _mm_cmple_ps(a, b); }
+    inline Lanes Select(Lanes m, Lanes a, Lanes b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); } // no blendv before SSE4.1
+    inline bool  None(Lanes m)                     { return _mm_movemask_ps(m) == 0; }
+    inline float HorizontalMax(Lanes m) {
+      m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+      m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+      return _mm_cvtss_f32(m);
+    }
+#include "core/collider_lanes.h"
+  };
+
+  // lane groups first, the scalar loop takes the remainder
+  template<typename Shape>
+  float CollideLanes(const Shape& shape, Points<float>& points, int begin, int end, float thickness, float friction) {
+    float depth = 0.0f;
+#if defined(XPBD_AVX2)
+    int   num   = UseAvx2() ? avx2::CollideSimd(shape, points, begin, end, thickness, friction, depth)
+                          : sse2::CollideSimd(shape, points, begin, end, thickness, friction, depth);
+#else
+    int   num   = sse2::CollideSimd(shape, points, begin, end, thickness, friction, depth);
+#endif
+    return std::max(depth, Collide(shape, points, begin + num, end, thickness, friction));
+  }
+  float CollideRange(const Colliders::Plane& c, Points<float>& points, int begin, int end, float thickness, float friction)   { return CollideLanes(c, points, begin, end, thickness, friction); }
+  float CollideRange(const Colliders::Sphere& c, Points<float>& points, int begin, int end, float thickness, float friction)  { return CollideLanes(c, points, begin, end, thickness, friction); }
+  float CollideRange(const Colliders::Capsule& c, Points<float>& points, int begin, int end, float thickness, float friction) { return CollideLanes(c, points, begin, end, thickness, friction); }
+  float CollideRange(const Colliders::Box& c, Points<float>& points, int begin, int end, float thickness, float friction)     { return CollideLanes(c, points, begin, end, thickness, friction); }
+
+  void Bounds(const Points<float>& points, int begin, int end, glm::vec3& lo, glm::vec3& hi) {
+#if defined(XPBD_AVX2)
+    if (UseAvx2()) {
+      avx2::Bounds(points, begin, end, lo, hi);
+      return;
+    }
+#endif
+    sse2::Bounds(points, begin, end, lo, hi);
+  }
+};
+#endif
+
+template<typename Real>
+Real Colliders::Solve(Points<Real>& points, int begin, int end) const {
+  const int BLOCK = 256; // points per bounds test, the morton order keeps a block compact so most colliders skip it
+  Real      depth = (Real)0.0;
+  for(int b = begin; b < end; b += BLOCK) {
+    int       e = std::min(b + BLOCK, end);
+    glm::vec3 lo, hi;
+    Bounds(points, b, e, lo, hi);
+    auto solve = [&](const auto& shapes) {
+      for(const auto& shape : shapes) {
+        if (!Touches(shape, lo, hi, thickness)) {
+          continue;
+        }
+        Real d = CollideRange(shape, points, b, e, (Real)thickness, (Real)friction);
+        if (d > (Real)0.0) { // the block moved, later colliders test where it went
+          depth = std::max(depth, d);
+          Bounds(points, b, e, lo, hi);
+        }
+      }
+    };
+    solve(planes);
+    solve(spheres);
+    solve(capsules);
+    solve(boxes);
+  }
+  return depth;
+}
+
+template<typename Real>
+int Colliders::Sweep(Points<Real>& points, int begin, int end) const {
+  const int BLOCK = 256;
+  int       num   = 0;
+  Real      t[BLOCK];
+  for(int b = begin; b < end; b += BLOCK) {
+    int       e = std::min(b + BLOCK, end);
+    glm::vec3 lo, hi;
+    SweptBounds(points, b, e, lo, hi);
+    std::fill(t, t + (e - b), (Real)1.0);
+    auto sweep = [&](const auto& shapes) {
+      for(const auto& shape : shapes) {
+        if (Touches(shape, lo, hi, thickness)) {
+          SweepRange(shape, points, b, e, (Real)thickness, t);
+        }
+      }
+    };
+    sweep(spheres);
+    sweep(capsules);
+    sweep(boxes);
+    for(int i = b; i < e; i++) {
+      if (t[i - b] < (Real)1.0) {
+        points.pos_x[i] = points.prev_x[i] + (points.pos_x[i] - points.prev_x[i]) * t[i - b];
+        points.pos_y[i] = points.prev_y[i] + (points.pos_y[i] - points.prev_y[i]) * t[i - b];
+        points.pos_z[i] = points.prev_z[i] + (points.pos_z[i] - points.prev_z[i]) * t[i - b];
+        num++;
+      }
+    }
+  }
+  return num;
+}
+
+template float  Colliders::Solve(Points<float>& points, int begin, int end) const;
+template double Colliders::Solve(Points<double>& points, int begin, int end) const;
+template int    Colliders::Sweep(Points<float>& points, int begin, int end) const;
+template int    Colliders::Sweep(Points<double>& points, int begin, int end) const;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "core/points.h"
+
+// static collision proxies. every point keeps thickness away from every collider, an XPBD inequality
+// C(x) = d(x) - thickness >= 0 with zero compliance, so eq.18 reduces to a projection along the surface normal
+// and no lambda outlives the pass. friction then removes the tangential motion of the step, up to friction * penetration
+class Colliders {
+public:
+  struct Plane {                   // half space dot(normal, x) + offset >= 0, normal is unit length
+    glm::vec3 normal;
+    float     offset;
+  };
+  struct Sphere {
+    glm::vec3 center;
+    float     radius;
+  };
+  struct Capsule {                 // points within radius of the segment p0 p1
+    glm::vec3 p0;
+    glm::vec3 p1;
+    float     radius;
+  };
+  struct Box {                     // oriented, the columns of axes are the box frame
+    glm::vec3 center;
+    glm::vec3 half;
+    glm::mat3 axes;
+  };
+  std::vector<Plane>   planes;
+  std::vector<Sphere>  spheres;
+  std::vector<Capsule> capsules;
+  std::vector<Box>     boxes;
+  float                thickness;  // distance kept from every surface
+  float                friction;   // coulomb coefficient, static and kinetic alike
+  Colliders() : planes(), spheres(), capsules(), boxes(), thickness(0.01f), friction(0.3f) {}
+  bool  Empty() const { return planes.empty() && spheres.empty() && capsules.empty() && boxes.empty(); }
+  void  Clear() { planes.clear(); spheres.clear(); capsules.clear(); boxes.clear(); }
+  // plane equation a x + b y + c z + d = 0, (a, b, c) points to the free side and need not be unit length
+  void  AddPlane(const glm::vec4& eq);
+  void  AddSphere(const glm::vec3& center, float radius)                      { spheres.push_back({ center, radius }); }
+  void  AddCapsule(const glm::vec3& p0, const glm::vec3& p1, float radius)    { capsules.push_back({ p0, p1, radius }); }
+  void  AddBox(const glm::vec3& center, const glm::vec3& half, const glm::mat3& axes = glm::mat3(1.0f)) { boxes.push_back({ center, half, axes }); }
+  // push points[begin, end) out of every collider, one collider at a time over the whole range so float points
+  // run 8 (AVX2) or 4 (SSE2) lanes per collider. returns the deepest penetration seen before the projection
+  template<typename Real>
+  Real  Solve(Points<Real>& points, int begin, int end) const;
+  // continuous test of the motion of the step, prev -> pos. a point whose path enters a collider and ends where the
+  // projection would push it out through the far side, or past the collider altogether, stops where it entered.
+  // planes are skipped, a half space cannot be crossed. returns the points stopped
+  template<typename Real>
+  int   Sweep(Points<Real>& points, int begin, int end) const;
+};
@@ -0,0 +1,139 @@
+// the collider kernels over the lane operations of the including namespace : Lanes, LANES, Set, Load, ..., HorizontalMax.
+// collider.cpp includes it once per lane width, so there is deliberately no include guard
+
+  inline Lanes Dot(const Lanes* a, const Lanes* b) { return Add(Add(Mul(a[0], b[0]), Mul(a[1], b[1])), Mul(a[2], b[2])); }
+  inline Lanes CopySign(Lanes a, Lanes s)          { return Or(AndNot(Set(-0.0f), a), And(Set(-0.0f), s)); }
+
+  // lane versions of Distance, every normal stays finite so a masked lane never turns into a nan
+  inline Lanes Distance(const Colliders::Plane& c, const Lanes* x, Lanes* n) {
+    for (int k = 0; k < 3; k++) {
+      n[k] = Set(c.normal[k]);
+    }
+    return Add(Dot(n, x), Set(c.offset));
+  }
+
+  inline Lanes Distance(const Colliders::Sphere& c, const Lanes* x, Lanes* n) {
+    Lanes diff[3];
+    for (int k = 0; k < 3; k++) {
+      diff[k] = Sub(x[k], Set(c.center[k]));
+    }
+    Lanes len = Sqrt(Dot(diff, diff));
+    Lanes inv = Div(Set(1.0f), Max(len, Set(FLT_EPSILON)));
+    for (int k = 0; k < 3; k++) {
+      n[k] = Mul(diff[k], inv);
+    }
+    return Sub(len, Set(c.radius));
+  }
+
+  inline Lanes Distance(const Colliders::Capsule& c, const Lanes* x, Lanes* n) {
+    glm::vec3 axis    = c.p1 - c.p0;
+    float     inv_len = 1.0f / std::max(glm::dot(axis, axis), FLT_EPSILON);
+    Lanes     rel[3], a[3], diff[3];
+    for (int k = 0; k < 3; k++) {
+      rel[k] = Sub(x[k], Set(c.p0[k]));
+      a[k]   = Set(axis[k]);
+    }
+    Lanes t = Min(Max(Mul(Dot(rel, a), Set(inv_len)), Set(0.0f)), Set(1.0f));
+    for (int k = 0; k < 3; k++) {
+      diff[k] = Sub(rel[k], Mul(a[k], t));
+    }
+    Lanes len = Sqrt(Dot(diff, diff));
+    Lanes inv = Div(Set(1.0f), Max(len, Set(FLT_EPSILON)));
+    for (int k = 0; k < 3; k++) {
+      n[k] = Mul(diff[k], inv);
+    }
+    return Sub(len, Set(c.radius));
+  }
+
+  inline Lanes Distance(const Colliders::Box& c, const Lanes* x, Lanes* n) {
+    const Lanes zero = Set(0.0f);
+    Lanes rel[3], q[3], e[3], o[3], local[3];
+    for (int k = 0; k < 3; k++) {
+      rel[k] = Sub(x[k], Set(c.center[k]));
+    }
+    for (int k = 0; k < 3; k++) {
+      Lanes axis[3] = { Set(c.axes[k][0]), Set(c.axes[k][1]), Set(c.axes[k][2]) };
+      q[k] = Dot(axis, rel);
+      e[k] = Sub(AndNot(Set(-0.0f), q[k]), Set(c.half[k]));
+      o[k] = Max(e[k], zero);
+    }
+    Lanes outside = Sqrt(Dot(o, o));
+    Lanes inside  = Max(Max(e[0], e[1]), e[2]);
+    Lanes is_out  = Less(zero, outside);
+    Lanes inv     = Div(Set(1.0f), Max(outside, Set(FLT_EPSILON)));
+    Lanes taken   = zero;               // inside : the first face at the least negative distance
+    for (int k = 0; k < 3; k++) {
+      Lanes face = AndNot(taken, LessEqual(inside, e[k]));
+      taken    = Or(taken, face);
+      local[k] = CopySign(Select(is_out, Mul(o[k], inv), And(face, Set(1.0f))), q[k]);
+    }
+    for (int k = 0; k < 3; k++) {
+      n[k] = Add(Add(Mul(Set(c.axes[0][k]), local[0]), Mul(Set(c.axes[1][k]), local[1])), Mul(Set(c.axes[2][k]), local[2]));
+    }
+    return Select(is_out, outside, inside);
+  }
+
+  // Collide over whole lane groups of points[begin, end), returns how many points it took
+  template<typename Shape>
+  int CollideSimd(const Shape& shape, Points<float>& points, int begin, int end, float thickness, float friction, float& depth) {
+    const Lanes zero  = Set(0.0f);
+    const Lanes thick = Set(thickness);
+    const Lanes mu    = Set(friction);
+    const Lanes eps   = Set(FLT_EPSILON);
+    float*      px[3] = { points.pos_x.data(),  points.pos_y.data(),  points.pos_z.data() };
+    const float* qx[3] = { points.prev_x.data(), points.prev_y.data(), points.prev_z.data() };
+    Lanes       vdepth = zero;
+    int         num    = (end - begin) / LANES * LANES;
+    for (int i = begin; i < begin + num; i += LANES) {
+      Lanes x[3] = { Load(px[0] + i), Load(px[1] + i), Load(px[2] + i) };
+      Lanes n[3];
+      Lanes pen = Sub(thick, Distance(shape, x, n));
+      Lanes hit = And(Less(zero, pen), LessEqual(eps, Load(points.inv_mass.data() + i)));
+      if (None(hit)) { // the common case, nothing to store
+        continue;
+      }
+      pen    = And(hit, pen); // 0 on the other lanes, so they move by 0 below
+      vdepth = Max(vdepth, pen);
+      Lanes disp[3], t[3];
+      for (int k = 0; k < 3; k++) {
+        x[k]    = Add(x[k], Mul(n[k], pen));
+        disp[k] = Sub(x[k], Load(qx[k] + i));
+      }
+      Lanes dn = Dot(disp, n);
+      for (int k = 0; k < 3; k++) {
+        t[k] = Sub(disp[k], Mul(n[k], dn));
+      }
+      Lanes len = Sqrt(Dot(t, t));
+      Lanes s   = Min(Div(Mul(mu, pen), Max(len, eps)), Set(1.0f));
+      for (int k = 0; k < 3; k++) {
+        Store(px[k] + i, Sub(x[k], Mul(t[k], s)));
+      }
+    }
+    depth = std::max(depth, HorizontalMax(vdepth));
+    return num;
+  }
+
+  void Bounds(const Points<float>& points, int begin, int end, glm::vec3& lo, glm::vec3& hi) {
+    const float* px[3] = { points.pos_x.data(), points.pos_y.data(), points.pos_z.data() };
+    int          num   = (end - begin) / LANES * LANES;
+    Lanes        l[3], h[3];
+    for (int k = 0; k < 3; k++) {
+      l[k] = Set(FLT_MAX);
+      h[k] = Set(-FLT_MAX);
+    }
+    for (int i = begin; i < begin + num; i += LANES) {
+      for (int k = 0; k < 3; k++) {
+        Lanes x = Load(px[k] + i);
+        l[k] = Min(l[k], x);
+        h[k] = Max(h[k], x);
+      }
+    }
+    for (int k = 0; k < 3; k++) {
+      lo[k] = -HorizontalMax(Sub(Set(0.0f), l[k]));
+      hi[k] = HorizontalMax(h[k]);
+    }
+    for (int i = begin + num; i < end; i++) {
+      lo = glm::min(lo, points.Position(i));
+      hi = glm::max(hi, points.Position(i));
+    }
+  }
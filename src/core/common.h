@@ -0,0 +1,105 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cfloat>
+#include <new>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+// parameter and render precision, the solver types are templated on their own scalar (see ePrecision)
+typedef float     Float;
+typedef glm::vec3 Vec3;
+typedef glm::vec2 Vec2;
+typedef glm::quat Quat;
+typedef glm::mat3 Mat3;
+
+namespace {
+  const Float FIXED_DT  = (Float)(1.0 / 30.0);
+  const Float GRAVITY   = (Float)9.8;
+  enum eMat : int {
+    eMat_Concrete,
+    eMat_Wood,
+    eMat_Leather,
+    eMat_Tendon,
+    eMat_Rubber,
+    eMat_Muscle,
+    eMat_Fat,
+    eMat_Max,
+  };
+  enum eIntegrator : int {
+    eIntegrator_Iteration, // one step per frame, num_iteration solver passes
+    eIntegrator_Substep,   // num_substep small steps per frame, one solver pass each
+    eIntegrator_Max,
+  };
+  enum eSolver : int {
+    eSolver_GaussSeidel,
+    eSolver_Jacobi,
+    eSolver_Max,
+  };
+  enum ePrecision : int {
+    ePrecision_Float,      // float positions and lambdas
+    ePrecision_Double,     // double positions and lambdas
+    ePrecision_Mixed,      // float positions, lambdas accumulated in double
+    ePrecision_Max,
+  };
+  enum eConstraint : int { // constraint batches, a scene leaves the ones it does not use empty
+    eConstraint_Structural,  // cloth grid edges, soft body tet edges
+    eConstraint_Shear,
+    eConstraint_Bend,
+    eConstraint_Volume,      // soft body tets
+    eConstraint_Deviatoric,  // soft body neo-hookean tets, shape
+    eConstraint_Hydrostatic, // soft body neo-hookean tets, volume
+    eConstraint_Max,
+  };
+  enum eTetModel : int {   // soft body constraints per tet
+    eTetModel_Volume,        // tet edges and V - V0
+    eTetModel_NeoHookean,    // deviatoric and hydrostatic neo-hookean, lame parameters from the compliance
+    eTetModel_Max,
+  };
+  static const float MAT_COMPLIANCE[eMat_Max] = { // Miles Macklin's blog (http://blog.mmacklin.com/2016/10/12/xpbd-slides-and-stiffness/)
+    0.00000000004f, // 0.04 x 10^(-9) (M^2/N) Concrete
+    0.00000000016f, // 0.16 x 10^(-9) (M^2/N) Wood
+    0.000000001f,   // 1.0  x 10^(-8) (M^2/N) Leather
+    0.000000002f,   // 0.2  x 10^(-7) (M^2/N) Tendon
+    0.0000001f,     // 1.0  x 10^(-6) (M^2/N) Rubber
+    0.00002f,       // 0.2  x 10^(-3) (M^2/N) Muscle
+    0.0001f,        // 1.0  x 10^(-3) (M^2/N) Fat
+  };
+  static const float POISSON_RATIO = 0.45f; // neo-hookean tets, soft tissue is nearly incompressible
+};
+
+template<typename T, std::size_t Align = 32>
+class AlignedAllocator {
+public:
+  typedef T value_type;
+  template<typename U> struct rebind { typedef AlignedAllocator<U, Align> other; };
+  AlignedAllocator() {}
+  template<typename U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+  T* allocate(std::size_t n) {
+    void* ptr = nullptr;
+#if defined(_MSC_VER)
+    ptr = _aligned_malloc(n * sizeof(T), Align);
+#else
+    if (posix_memalign(&ptr, Align, n * sizeof(T)) != 0) { ptr = nullptr; }
+#endif
+    if (ptr == nullptr) { throw std::bad_alloc(); }
+    return static_cast<T*>(ptr);
+  }
+  void deallocate(T* ptr, std::size_t) {
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+  }
+  template<typename U> bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+  template<typename U> bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+};
+
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
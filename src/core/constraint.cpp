@@ -0,0 +1,752 @@
+#include "core/constraint.h"
+#include "core/simd.h"
+#include <algorithm>
+
+#if defined(XPBD_AVX2)
+XPBD_AVX2_BEGIN
+namespace avx2 {
+  namespace {
+    // 8 records of 8 words at rec, rec + stride, ... -> word[j] holds word j of every record
+    inline void Transpose8(const float* rec, int stride, __m256* word) {
+      __m256 row[8], tmp[8];
+      for (int j = 0; j < 8; j++) {
+        row[j] = _mm256_loadu_ps(rec + j * stride);
+      }
+      for (int j = 0; j < 8; j += 2) {
+        tmp[j]     = _mm256_unpacklo_ps(row[j], row[j + 1]);
+        tmp[j + 1] = _mm256_unpackhi_ps(row[j], row[j + 1]);
+      }
+      for (int j = 0; j < 8; j += 4) {
+        row[j]     = _mm256_shuffle_ps(tmp[j],     tmp[j + 2], _MM_SHUFFLE(1, 0, 1, 0));
+        row[j + 1] = _mm256_shuffle_ps(tmp[j],     tmp[j + 2], _MM_SHUFFLE(3, 2, 3, 2));
+        row[j + 2] = _mm256_shuffle_ps(tmp[j + 1], tmp[j + 3], _MM_SHUFFLE(1, 0, 1, 0));
+        row[j + 3] = _mm256_shuffle_ps(tmp[j + 1], tmp[j + 3], _MM_SHUFFLE(3, 2, 3, 2));
+      }
+      for (int j = 0; j < 4; j++) {
+        word[j]     = _mm256_permute2f128_ps(row[j], row[j + 4], 0x20);
+        word[j + 4] = _mm256_permute2f128_ps(row[j], row[j + 4], 0x31);
+      }
+    }
+
+    // F = Ds Dm^-1 and dC/dF of 8 tets at once, the record is transposed into one register per word (idx, Dm^-1, V0, scale, gamma)
+    template<bool Hydrostatic>
+    int SolveNeoHookean8(const NeoHookeanConstraint<float, Hydrostatic>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+      static_assert(sizeof(NeoHookeanConstraint<float, Hydrostatic>) == 16 * sizeof(std::int32_t), "packed tet record expected");
+      const __m256  va     = _mm256_set1_ps(alpha);
+      const __m256  eps    = _mm256_set1_ps(FLT_EPSILON);
+      const __m256  eps2   = _mm256_set1_ps(FLT_EPSILON * FLT_EPSILON);
+      const __m256  sign   = _mm256_set1_ps(-0.0f);
+      __m256        vres   = _mm256_setzero_ps();
+      float*        px     = points.pos_x.data();
+      float*        py     = points.pos_y.data();
+      float*        pz     = points.pos_z.data();
+      const float*  im     = points.inv_mass.data();
+      alignas(32) std::int32_t vi[4][8];
+      alignas(32) float        nx[4][8], ny[4][8], nz[4][8];
+      int n = count & ~7;
+      for (int i = 0; i < n; i += 8) {
+        const float* rec = reinterpret_cast<const float*>(c + i);
+        __m256 word[16];
+        Transpose8(rec,     16, word);
+        Transpose8(rec + 8, 16, word + 8);
+        const __m256* dm = word + 4; // Dm^-1 column major
+        __m256i idx[4];
+        __m256  w[4], x[4], y[4], z[4];
+        for (int j = 0; j < 4; j++) {
+          idx[j] = _mm256_castps_si256(word[j]);
+          w[j]   = _mm256_i32gather_ps(im, idx[j], 4);
+          x[j]   = _mm256_i32gather_ps(px, idx[j], 4);
+          y[j]   = _mm256_i32gather_ps(py, idx[j], 4);
+          z[j]   = _mm256_i32gather_ps(pz, idx[j], 4);
+        }
+        __m256 fx[3], fy[3], fz[3];
+        for (int col = 0; col < 3; col++) { // F column = sum_k Ds column k * Dm^-1[col][k]
+          fx[col] = fy[col] = fz[col] = _mm256_setzero_ps();
+          for (int k = 0; k < 3; k++) {
+            __m256 m = dm[col * 3 + k];
+            fx[col]  = _mm256_add_ps(fx[col], _mm256_mul_ps(_mm256_sub_ps(x[k + 1], x[0]), m));
+            fy[col]  = _mm256_add_ps(fy[col], _mm256_mul_ps(_mm256_sub_ps(y[k + 1], y[0]), m));
+            fz[col]  = _mm256_add_ps(fz[col], _mm256_mul_ps(_mm256_sub_ps(z[k + 1], z[0]), m));
+          }
+        }
+        __m256 cj, dcx[3], dcy[3], dcz[3]; // Cj(x), dC/dF
+        if (Hydrostatic) {
+          for (int col = 0; col < 3; col++) { // cofactor, column col is F column a x F column b
+            int a = (col + 1) % 3, b = (col + 2) % 3;
+            dcx[col] = _mm256_sub_ps(_mm256_mul_ps(fy[a], fz[b]), _mm256_mul_ps(fz[a], fy[b]));
+            dcy[col] = _mm256_sub_ps(_mm256_mul_ps(fz[a], fx[b]), _mm256_mul_ps(fx[a], fz[b]));
+            dcz[col] = _mm256_sub_ps(_mm256_mul_ps(fx[a], fy[b]), _mm256_mul_ps(fy[a], fx[b]));
+          }
+          __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(fx[0], dcx[0]), _mm256_mul_ps(fy[0], dcy[0])), _mm256_mul_ps(fz[0], dcz[0]));
+          cj = _mm256_sub_ps(det, word[15]);
+        } else {
+          __m256 sum = _mm256_setzero_ps();
+          for (int col = 0; col < 3; col++) {
+            sum = _mm256_add_ps(sum, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(fx[col], fx[col]), _mm256_mul_ps(fy[col], fy[col])), _mm256_mul_ps(fz[col], fz[col])));
+          }
+          cj = _mm256_sqrt_ps(sum);
+          __m256 inv = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_max_ps(cj, eps));
+          for (int col = 0; col < 3; col++) {
+            dcx[col] = _mm256_mul_ps(fx[col], inv);
+            dcy[col] = _mm256_mul_ps(fy[col], inv);
+            dcz[col] = _mm256_mul_ps(fz[col], inv);
+          }
+        }
+        __m256 gx[4], gy[4], gz[4];
+        gx[0] = gy[0] = gz[0] = _mm256_setzero_ps();
+        for (int j = 1; j < 4; j++) { // grad_j = dC/dF Dm^-T column j-1
+          gx[j] = gy[j] = gz[j] = _mm256_setzero_ps();
+          for (int col = 0; col < 3; col++) {
+            __m256 m = dm[col * 3 + j - 1];
+            gx[j]    = _mm256_add_ps(gx[j], _mm256_mul_ps(dcx[col], m));
+            gy[j]    = _mm256_add_ps(gy[j], _mm256_mul_ps(dcy[col], m));
+            gz[j]    = _mm256_add_ps(gz[j], _mm256_mul_ps(dcz[col], m));
+          }
+          gx[0] = _mm256_sub_ps(gx[0], gx[j]);
+          gy[0] = _mm256_sub_ps(gy[0], gy[j]);
+          gz[0] = _mm256_sub_ps(gz[0], gz[j]);
+        }
+        __m256 sum_w = _mm256_setzero_ps();
+        for (int j = 0; j < 4; j++) {
+          __m256 g2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx[j], gx[j]), _mm256_mul_ps(gy[j], gy[j])), _mm256_mul_ps(gz[j], gz[j]));
+          sum_w     = _mm256_add_ps(sum_w, _mm256_mul_ps(w[j], g2));
+        }
+        __m256 a    = _mm256_mul_ps(va, word[14]);
+        __m256 lam  = _mm256_loadu_ps(lambda + i);
+        __m256 dl   = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), cj), _mm256_mul_ps(a, lam)),
+                                    _mm256_add_ps(sum_w, a));                                                    // eq.18
+        __m256 live = _mm256_cmp_ps(sum_w, eps2, _CMP_GE_OQ);
+        dl          = _mm256_and_ps(dl, live);
+        vres        = _mm256_max_ps(vres, _mm256_and_ps(_mm256_andnot_ps(sign, _mm256_add_ps(cj, _mm256_mul_ps(a, lam))), live));
+        _mm256_storeu_ps(lambda + i, _mm256_add_ps(lam, dl));
+        for (int j = 0; j < 4; j++) {
+          __m256 f = _mm256_mul_ps(dl, w[j]);                                                                   // eq.17
+          _mm256_store_si256(reinterpret_cast<__m256i*>(vi[j]), idx[j]);
+          _mm256_store_ps(nx[j], _mm256_add_ps(x[j], _mm256_mul_ps(f, gx[j])));
+          _mm256_store_ps(ny[j], _mm256_add_ps(y[j], _mm256_mul_ps(f, gy[j])));
+          _mm256_store_ps(nz[j], _mm256_add_ps(z[j], _mm256_mul_ps(f, gz[j])));
+        }
+        for (int l = 0; l < 8; l++) { // no scatter in AVX2
+          for (int j = 0; j < 4; j++) {
+            px[vi[j][l]] = nx[j][l]; py[vi[j][l]] = ny[j][l]; pz[vi[j][l]] = nz[j][l];
+          }
+        }
+      }
+      alignas(32) float r[8];
+      _mm256_store_ps(r, vres);
+      for (int l = 0; l < 8; l++) {
+        residual = std::max(residual, r[l]);
+      }
+      return n;
+    }
+  };
+
+  int SolveDistanceSimd(const DistanceConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    static_assert(sizeof(DistanceConstraint<float>) == 3 * sizeof(std::int32_t), "packed constraint record expected");
+    const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256  va     = _mm256_set1_ps(alpha);
+    const __m256  eps    = _mm256_set1_ps(FLT_EPSILON);
+    const __m256  sign   = _mm256_set1_ps(-0.0f);
+    __m256        vres   = _mm256_setzero_ps();
+    float*        px     = points.pos_x.data();
+    float*        py     = points.pos_y.data();
+    float*        pz     = points.pos_z.data();
+    const float*  im     = points.inv_mass.data();
+    alignas(32) std::int32_t i0[8], i1[8];
+    alignas(32) float        x0[8], y0[8], z0[8], x1[8], y1[8], z1[8];
+    int n = count & ~7;
+    for (int i = 0; i < n; i += 8) {
+      const std::int32_t* rec = reinterpret_cast<const std::int32_t*>(c + i);
+      __m256i vi0  = _mm256_i32gather_epi32(rec + 0, stride, 4);
+      __m256i vi1  = _mm256_i32gather_epi32(rec + 1, stride, 4);
+      __m256  rest = _mm256_i32gather_ps(reinterpret_cast<const float*>(rec + 2), stride, 4);
+      __m256  w0   = _mm256_i32gather_ps(im, vi0, 4);
+      __m256  w1   = _mm256_i32gather_ps(im, vi1, 4);
+      __m256  vx0  = _mm256_i32gather_ps(px, vi0, 4);
+      __m256  vy0  = _mm256_i32gather_ps(py, vi0, 4);
+      __m256  vz0  = _mm256_i32gather_ps(pz, vi0, 4);
+      __m256  vx1  = _mm256_i32gather_ps(px, vi1, 4);
+      __m256  vy1  = _mm256_i32gather_ps(py, vi1, 4);
+      __m256  vz1  = _mm256_i32gather_ps(pz, vi1, 4);
+      __m256  gx   = _mm256_sub_ps(vx0, vx1);
+      __m256  gy   = _mm256_sub_ps(vy0, vy1);
+      __m256  gz   = _mm256_sub_ps(vz0, vz1);
+      __m256  d    = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gy, gy)), _mm256_mul_ps(gz, gz)));
+      __m256  w    = _mm256_add_ps(w0, w1);
+      __m256  lam  = _mm256_loadu_ps(lambda + i);
+      __m256  cj   = _mm256_sub_ps(d, rest);                                                                     // Cj(x)
+      __m256  dl   = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), cj), _mm256_mul_ps(va, lam)),
+                                   _mm256_add_ps(w, va));                                                        // eq.18
+      __m256  live = _mm256_cmp_ps(w, eps, _CMP_GE_OQ);
+      dl           = _mm256_and_ps(dl, live);
+      vres         = _mm256_max_ps(vres, _mm256_and_ps(_mm256_andnot_ps(sign, _mm256_add_ps(cj, _mm256_mul_ps(va, lam))), live));
+      _mm256_storeu_ps(lambda + i, _mm256_add_ps(lam, dl));
+      __m256  s    = _mm256_div_ps(dl, _mm256_add_ps(d, eps));                                                  // eq.17
+      __m256  cx   = _mm256_mul_ps(s, gx);
+      __m256  cy   = _mm256_mul_ps(s, gy);
+      __m256  cz   = _mm256_mul_ps(s, gz);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(i0), vi0);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(i1), vi1);
+      _mm256_store_ps(x0, _mm256_add_ps(vx0, _mm256_mul_ps(cx, w0)));
+      _mm256_store_ps(y0, _mm256_add_ps(vy0, _mm256_mul_ps(cy, w0)));
+      _mm256_store_ps(z0, _mm256_add_ps(vz0, _mm256_mul_ps(cz, w0)));
+      _mm256_store_ps(x1, _mm256_sub_ps(vx1, _mm256_mul_ps(cx, w1)));
+      _mm256_store_ps(y1, _mm256_sub_ps(vy1, _mm256_mul_ps(cy, w1)));
+      _mm256_store_ps(z1, _mm256_sub_ps(vz1, _mm256_mul_ps(cz, w1)));
+      for (int k = 0; k < 8; k++) { // no scatter in AVX2
+        px[i0[k]] = x0[k]; py[i0[k]] = y0[k]; pz[i0[k]] = z0[k];
+        px[i1[k]] = x1[k]; py[i1[k]] = y1[k]; pz[i1[k]] = z1[k];
+      }
+    }
+    alignas(32) float r[8];
+    _mm256_store_ps(r, vres);
+    for (int k = 0; k < 8; k++) {
+      residual = std::max(residual, r[k]);
+    }
+    return n;
+  }
+
+  int SolveDihedralSimd(const DihedralConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    static_assert(sizeof(DihedralConstraint<float>) == 8 * sizeof(std::int32_t), "packed hinge record expected");
+    const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21); // lambdas of 8 records, one axis
+    const __m256  va     = _mm256_set1_ps(alpha);
+    const __m256  eps    = _mm256_set1_ps(FLT_EPSILON);
+    const __m256  sign   = _mm256_set1_ps(-0.0f);
+    __m256        vres   = _mm256_setzero_ps();
+    float*        px     = points.pos_x.data();
+    float*        py     = points.pos_y.data();
+    float*        pz     = points.pos_z.data();
+    const float*  im     = points.inv_mass.data();
+    alignas(32) std::int32_t vi[4][8];
+    alignas(32) float        nx[4][8], ny[4][8], nz[4][8], nl[3][8];
+    int n = count & ~7;
+    for (int i = 0; i < n; i += 8) {
+      // one record is 8 words, so a 8x8 transpose of 8 records gives idx[0..3] and k[0..3] across the lanes
+      __m256  word[8];
+      Transpose8(reinterpret_cast<const float*>(c + i), 8, word);
+      __m256i idx[4];
+      __m256  k[4], w[4], x[4], y[4], z[4];
+      for (int j = 0; j < 4; j++) {
+        idx[j] = _mm256_castps_si256(word[j]);
+        k[j]   = word[j + 4];
+      }
+      __m256  vx = _mm256_setzero_ps(), vy = _mm256_setzero_ps(), vz = _mm256_setzero_ps(), sum_w = _mm256_setzero_ps();
+      for (int j = 0; j < 4; j++) {
+        w[j]   = _mm256_i32gather_ps(im, idx[j], 4);
+        x[j]   = _mm256_i32gather_ps(px, idx[j], 4);
+        y[j]   = _mm256_i32gather_ps(py, idx[j], 4);
+        z[j]   = _mm256_i32gather_ps(pz, idx[j], 4);
+        vx     = _mm256_add_ps(vx, _mm256_mul_ps(k[j], x[j]));
+        vy     = _mm256_add_ps(vy, _mm256_mul_ps(k[j], y[j]));
+        vz     = _mm256_add_ps(vz, _mm256_mul_ps(k[j], z[j]));
+        sum_w  = _mm256_add_ps(sum_w, _mm256_mul_ps(w[j], _mm256_mul_ps(k[j], k[j])));
+      }
+      __m256 v[3] = { vx, vy, vz }, dl[3];
+      __m256 den  = _mm256_add_ps(sum_w, va);
+      __m256 live = _mm256_cmp_ps(sum_w, eps, _CMP_GE_OQ);
+      for (int d = 0; d < 3; d++) {
+        __m256 lam = _mm256_i32gather_ps(lambda + 3 * i + d, stride, 4);
+        __m256 num = _mm256_add_ps(v[d], _mm256_mul_ps(va, lam));                                            // C_d(x) + a~ lambda_d
+        dl[d]      = _mm256_and_ps(_mm256_div_ps(_mm256_sub_ps(_mm256_setzero_ps(), num), den), live);       // eq.18
+        vres       = _mm256_max_ps(vres, _mm256_and_ps(_mm256_andnot_ps(sign, num), live));
+        _mm256_store_ps(nl[d], _mm256_add_ps(lam, dl[d]));
+      }
+      for (int l = 0; l < 8; l++) {
+        for (int d = 0; d < 3; d++) {
+          lambda[3 * (i + l) + d] = nl[d][l];
+        }
+      }
+      for (int j = 0; j < 4; j++) {
+        __m256 f = _mm256_mul_ps(w[j], k[j]);                                                                 // eq.17
+        _mm256_store_si256(reinterpret_cast<__m256i*>(vi[j]), idx[j]);
+        _mm256_store_ps(nx[j], _mm256_add_ps(x[j], _mm256_mul_ps(f, dl[0])));
+        _mm256_store_ps(ny[j], _mm256_add_ps(y[j], _mm256_mul_ps(f, dl[1])));
+        _mm256_store_ps(nz[j], _mm256_add_ps(z[j], _mm256_mul_ps(f, dl[2])));
+      }
+      for (int l = 0; l < 8; l++) { // no scatter in AVX2
+        for (int j = 0; j < 4; j++) {
+          px[vi[j][l]] = nx[j][l]; py[vi[j][l]] = ny[j][l]; pz[vi[j][l]] = nz[j][l];
+        }
+      }
+    }
+    alignas(32) float r[8];
+    _mm256_store_ps(r, vres);
+    for (int l = 0; l < 8; l++) {
+      residual = std::max(residual, r[l]);
+    }
+    return n;
+  }
+
+  int SolveVolumeSimd(const VolumeConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    static_assert(sizeof(VolumeConstraint<float>) == 5 * sizeof(std::int32_t), "packed tet record expected");
+    const __m256i stride = _mm256_setr_epi32(0, 5, 10, 15, 20, 25, 30, 35);
+    const __m256  va     = _mm256_set1_ps(alpha);
+    const __m256  eps    = _mm256_set1_ps(FLT_EPSILON * FLT_EPSILON);
+    const __m256  sign   = _mm256_set1_ps(-0.0f);
+    const __m256  sixth  = _mm256_set1_ps(1.0f / 6.0f);
+    __m256        vres   = _mm256_setzero_ps();
+    float*        px     = points.pos_x.data();
+    float*        py     = points.pos_y.data();
+    float*        pz     = points.pos_z.data();
+    const float*  im     = points.inv_mass.data();
+    alignas(32) std::int32_t vi[4][8];
+    alignas(32) float        nx[4][8], ny[4][8], nz[4][8];
+    int n = count & ~7;
+    for (int i = 0; i < n; i += 8) {
+      const std::int32_t* rec = reinterpret_cast<const std::int32_t*>(c + i);
+      __m256i idx[4];
+      __m256  w[4], x[4], y[4], z[4];
+      for (int j = 0; j < 4; j++) {
+        idx[j] = _mm256_i32gather_epi32(rec + j, stride, 4);
+        w[j]   = _mm256_i32gather_ps(im, idx[j], 4);
+        x[j]   = _mm256_i32gather_ps(px, idx[j], 4);
+        y[j]   = _mm256_i32gather_ps(py, idx[j], 4);
+        z[j]   = _mm256_i32gather_ps(pz, idx[j], 4);
+      }
+      __m256 rest = _mm256_i32gather_ps(reinterpret_cast<const float*>(rec + 4), stride, 4);
+      __m256 ex[4], ey[4], ez[4], gx[4], gy[4], gz[4];
+      for (int j = 1; j < 4; j++) {
+        ex[j] = _mm256_sub_ps(x[j], x[0]);
+        ey[j] = _mm256_sub_ps(y[j], y[0]);
+        ez[j] = _mm256_sub_ps(z[j], z[0]);
+      }
+      for (int j = 1; j < 4; j++) { // grad_j = e_j1 x e_j2 / 6 with (j1, j2) the next two edges in cyclic order
+        int j1 = (j % 3) + 1, j2 = ((j + 1) % 3) + 1;
+        gx[j] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(ey[j1], ez[j2]), _mm256_mul_ps(ez[j1], ey[j2])), sixth);
+        gy[j] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(ez[j1], ex[j2]), _mm256_mul_ps(ex[j1], ez[j2])), sixth);
+        gz[j] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(ex[j1], ey[j2]), _mm256_mul_ps(ey[j1], ex[j2])), sixth);
+      }
+      gx[0] = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_add_ps(_mm256_add_ps(gx[1], gx[2]), gx[3]));
+      gy[0] = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_add_ps(_mm256_add_ps(gy[1], gy[2]), gy[3]));
+      gz[0] = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_add_ps(_mm256_add_ps(gz[1], gz[2]), gz[3]));
+      __m256 sum_w = _mm256_setzero_ps();
+      for (int j = 0; j < 4; j++) {
+        __m256 g2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx[j], gx[j]), _mm256_mul_ps(gy[j], gy[j])), _mm256_mul_ps(gz[j], gz[j]));
+        sum_w     = _mm256_add_ps(sum_w, _mm256_mul_ps(w[j], g2));
+      }
+      __m256 vol  = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex[3], gx[3]), _mm256_mul_ps(ey[3], gy[3])), _mm256_mul_ps(ez[3], gz[3]));
+      __m256 cj   = _mm256_sub_ps(vol, rest);                                                                    // Cj(x)
+      __m256 lam  = _mm256_loadu_ps(lambda + i);
+      __m256 dl   = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), cj), _mm256_mul_ps(va, lam)),
+                                  _mm256_add_ps(sum_w, va));                                                     // eq.18
+      __m256 live = _mm256_cmp_ps(sum_w, eps, _CMP_GE_OQ);
+      dl          = _mm256_and_ps(dl, live);
+      vres        = _mm256_max_ps(vres, _mm256_and_ps(_mm256_andnot_ps(sign, _mm256_add_ps(cj, _mm256_mul_ps(va, lam))), live));
+      _mm256_storeu_ps(lambda + i, _mm256_add_ps(lam, dl));
+      for (int j = 0; j < 4; j++) {
+        __m256 f = _mm256_mul_ps(dl, w[j]);                                                                     // eq.17
+        _mm256_store_si256(reinterpret_cast<__m256i*>(vi[j]), idx[j]);
+        _mm256_store_ps(nx[j], _mm256_add_ps(x[j], _mm256_mul_ps(f, gx[j])));
+        _mm256_store_ps(ny[j], _mm256_add_ps(y[j], _mm256_mul_ps(f, gy[j])));
+        _mm256_store_ps(nz[j], _mm256_add_ps(z[j], _mm256_mul_ps(f, gz[j])));
+      }
+      for (int l = 0; l < 8; l++) { // no scatter in AVX2
+        for (int j = 0; j < 4; j++) {
+          px[vi[j][l]] = nx[j][l]; py[vi[j][l]] = ny[j][l]; pz[vi[j][l]] = nz[j][l];
+        }
+      }
+    }
+    alignas(32) float r[8];
+    _mm256_store_ps(r, vres);
+    for (int l = 0; l < 8; l++) {
+      residual = std::max(residual, r[l]);
+    }
+    return n;
+  }
+
+  int SolveNeoHookeanSimd(const DeviatoricConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    return SolveNeoHookean8(c, lambda, count, points, alpha, residual);
+  }
+
+  int SolveNeoHookeanSimd(const HydrostaticConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    return SolveNeoHookean8(c, lambda, count, points, alpha, residual);
+  }
+};
+XPBD_AVX2_END
+#endif
+
+#if defined(XPBD_SSE2)
+namespace sse2 {
+  namespace {
+    // F = Ds Dm^-1 and dC/dF of 4 tets at once, the record is transposed into one register per word (idx, Dm^-1, V0, scale, gamma)
+    template<bool Hydrostatic>
+    int SolveNeoHookean4(const NeoHookeanConstraint<float, Hydrostatic>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+      static_assert(sizeof(NeoHookeanConstraint<float, Hydrostatic>) == 16 * sizeof(std::int32_t), "packed tet record expected");
+      const __m128  va     = _mm_set1_ps(alpha);
+      const __m128  eps    = _mm_set1_ps(FLT_EPSILON);
+      const __m128  eps2   = _mm_set1_ps(FLT_EPSILON * FLT_EPSILON);
+      const __m128  sign   = _mm_set1_ps(-0.0f);
+      __m128        vres   = _mm_setzero_ps();
+      float*        px     = points.pos_x.data();
+      float*        py     = points.pos_y.data();
+      float*        pz     = points.pos_z.data();
+      const float*  im     = points.inv_mass.data();
+      alignas(16) float nx[4][4], ny[4][4], nz[4][4];
+      int n = count & ~3;
+      for (int i = 0; i < n; i += 4) {
+        const NeoHookeanConstraint<float, Hydrostatic>* b = c + i;
+        const float* rec = reinterpret_cast<const float*>(b);
+        __m128 word[16];
+        for (int q = 0; q < 16; q += 4) {
+          __m128 r0 = _mm_loadu_ps(rec + q), r1 = _mm_loadu_ps(rec + 16 + q), r2 = _mm_loadu_ps(rec + 32 + q), r3 = _mm_loadu_ps(rec + 48 + q);
+          _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+          word[q] = r0; word[q + 1] = r1; word[q + 2] = r2; word[q + 3] = r3;
+        }
+        const __m128* dm = word + 4; // Dm^-1 column major
+        __m128  w[4], x[4], y[4], z[4];
+        for (int j = 0; j < 4; j++) {
+          std::uint32_t a0 = b[0].idx[j], a1 = b[1].idx[j], a2 = b[2].idx[j], a3 = b[3].idx[j];
+          w[j] = _mm_setr_ps(im[a0], im[a1], im[a2], im[a3]);
+          x[j] = _mm_setr_ps(px[a0], px[a1], px[a2], px[a3]);
+          y[j] = _mm_setr_ps(py[a0], py[a1], py[a2], py[a3]);
+          z[j] = _mm_setr_ps(pz[a0], pz[a1], pz[a2], pz[a3]);
+        }
+        __m128 fx[3], fy[3], fz[3];
+        for (int col = 0; col < 3; col++) { // F column = sum_k Ds column k * Dm^-1[col][k]
+          fx[col] = fy[col] = fz[col] = _mm_setzero_ps();
+          for (int k = 0; k < 3; k++) {
+            __m128 m = dm[col * 3 + k];
+            fx[col]  = _mm_add_ps(fx[col], _mm_mul_ps(_mm_sub_ps(x[k + 1], x[0]), m));
+            fy[col]  = _mm_add_ps(fy[col], _mm_mul_ps(_mm_sub_ps(y[k + 1], y[0]), m));
+            fz[col]  = _mm_add_ps(fz[col], _mm_mul_ps(_mm_sub_ps(z[k + 1], z[0]), m));
+          }
+        }
+        __m128 cj, dcx[3], dcy[3], dcz[3]; // Cj(x), dC/dF
+        if (Hydrostatic) {
+          for (int col = 0; col < 3; col++) { // cofactor, column col is F column a x F column b
+            int a = (col + 1) % 3, b = (col + 2) % 3;
+            dcx[col] = _mm_sub_ps(_mm_mul_ps(fy[a], fz[b]), _mm_mul_ps(fz[a], fy[b]));
+            dcy[col] = _mm_sub_ps(_mm_mul_ps(fz[a], fx[b]), _mm_mul_ps(fx[a], fz[b]));
+            dcz[col] = _mm_sub_ps(_mm_mul_ps(fx[a], fy[b]), _mm_mul_ps(fy[a], fx[b]));
+          }
+          __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fx[0], dcx[0]), _mm_mul_ps(fy[0], dcy[0])), _mm_mul_ps(fz[0], dcz[0]));
+          cj = _mm_sub_ps(det, word[15]);
+        } else {
+          __m128 sum = _mm_setzero_ps();
+          for (int col = 0; col < 3; col++) {
+            sum = _mm_add_ps(sum, _mm_add_ps(_mm_add_ps(_mm_mul_ps(fx[col], fx[col]), _mm_mul_ps(fy[col], fy[col])), _mm_mul_ps(fz[col], fz[col])));
+          }
+          cj = _mm_sqrt_ps(sum);
+          __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(cj, eps));
+          for (int col = 0; col < 3; col++) {
+            dcx[col] = _mm_mul_ps(fx[col], inv);
+            dcy[col] = _mm_mul_ps(fy[col], inv);
+            dcz[col] = _mm_mul_ps(fz[col], inv);
+          }
+        }
+        __m128 gx[4], gy[4], gz[4];
+        gx[0] = gy[0] = gz[0] = _mm_setzero_ps();
+        for (int j = 1; j < 4; j++) { // grad_j = dC/dF Dm^-T column j-1
+          gx[j] = gy[j] = gz[j] = _mm_setzero_ps();
+          for (int col = 0; col < 3; col++) {
+            __m128 m = dm[col * 3 + j - 1];
+            gx[j]    = _mm_add_ps(gx[j], _mm_mul_ps(dcx[col], m));
+            gy[j]    = _mm_add_ps(gy[j], _mm_mul_ps(dcy[col], m));
+            gz[j]    = _mm_add_ps(gz[j], _mm_mul_ps(dcz[col], m));
+          }
+          gx[0] = _mm_sub_ps(gx[0], gx[j]);
+          gy[0] = _mm_sub_ps(gy[0], gy[j]);
+          gz[0] = _mm_sub_ps(gz[0], gz[j]);
+        }
+        __m128 sum_w = _mm_setzero_ps();
+        for (int j = 0; j < 4; j++) {
+          __m128 g2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx[j], gx[j]), _mm_mul_ps(gy[j], gy[j])), _mm_mul_ps(gz[j], gz[j]));
+          sum_w     = _mm_add_ps(sum_w, _mm_mul_ps(w[j], g2));
+        }
+        __m128 a    = _mm_mul_ps(va, word[14]);
+        __m128 lam  = _mm_loadu_ps(lambda + i);
+        __m128 dl   = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), cj), _mm_mul_ps(a, lam)),
+                                    _mm_add_ps(sum_w, a));                                                    // eq.18
+        __m128 live = _mm_cmpge_ps(sum_w, eps2);
+        dl          = _mm_and_ps(dl, live);
+        vres        = _mm_max_ps(vres, _mm_and_ps(_mm_andnot_ps(sign, _mm_add_ps(cj, _mm_mul_ps(a, lam))), live));
+        _mm_storeu_ps(lambda + i, _mm_add_ps(lam, dl));
+        for (int j = 0; j < 4; j++) {
+          __m128 f = _mm_mul_ps(dl, w[j]);                                                                   // eq.17
+          _mm_store_ps(nx[j], _mm_add_ps(x[j], _mm_mul_ps(f, gx[j])));
+          _mm_store_ps(ny[j], _mm_add_ps(y[j], _mm_mul_ps(f, gy[j])));
+          _mm_store_ps(nz[j], _mm_add_ps(z[j], _mm_mul_ps(f, gz[j])));
+        }
+        for (int l = 0; l < 4; l++) {
+          for (int j = 0; j < 4; j++) {
+            px[b[l].idx[j]] = nx[j][l]; py[b[l].idx[j]] = ny[j][l]; pz[b[l].idx[j]] = nz[j][l];
+          }
+        }
+      }
+      alignas(16) float r[4];
+      _mm_store_ps(r, vres);
+      for (int l = 0; l < 4; l++) {
+        residual = std::max(residual, r[l]);
+      }
+      return n;
+    }
+  };
+
+  int SolveDistanceSimd(const DistanceConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    const __m128  va   = _mm_set1_ps(alpha);
+    const __m128  eps  = _mm_set1_ps(FLT_EPSILON);
+    const __m128  sign = _mm_set1_ps(-0.0f);
+    __m128        vres = _mm_setzero_ps();
+    float*        px   = points.pos_x.data();
+    float*        py   = points.pos_y.data();
+    float*        pz   = points.pos_z.data();
+    const float*  im   = points.inv_mass.data();
+    alignas(16) float x0[4], y0[4], z0[4], x1[4], y1[4], z1[4];
+    int n = count & ~3;
+    for (int i = 0; i < n; i += 4) {
+      const DistanceConstraint<float>* b = c + i;
+      std::uint32_t a0 = b[0].idx0, a1 = b[1].idx0, a2 = b[2].idx0, a3 = b[3].idx0;
+      std::uint32_t b0 = b[0].idx1, b1 = b[1].idx1, b2 = b[2].idx1, b3 = b[3].idx1;
+      __m128 rest = _mm_setr_ps(b[0].rest_length, b[1].rest_length, b[2].rest_length, b[3].rest_length);
+      __m128 w0   = _mm_setr_ps(im[a0], im[a1], im[a2], im[a3]);
+      __m128 w1   = _mm_setr_ps(im[b0], im[b1], im[b2], im[b3]);
+      __m128 vx0  = _mm_setr_ps(px[a0], px[a1], px[a2], px[a3]);
+      __m128 vy0  = _mm_setr_ps(py[a0], py[a1], py[a2], py[a3]);
+      __m128 vz0  = _mm_setr_ps(pz[a0], pz[a1], pz[a2], pz[a3]);
+      __m128 vx1  = _mm_setr_ps(px[b0], px[b1], px[b2], px[b3]);
+      __m128 vy1  = _mm_setr_ps(py[b0], py[b1], py[b2], py[b3]);
+      __m128 vz1  = _mm_setr_ps(pz[b0], pz[b1], pz[b2], pz[b3]);
+      __m128 gx   = _mm_sub_ps(vx0, vx1);
+      __m128 gy   = _mm_sub_ps(vy0, vy1);
+      __m128 gz   = _mm_sub_ps(vz0, vz1);
+      __m128 d    = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)), _mm_mul_ps(gz, gz)));
+      __m128 w    = _mm_add_ps(w0, w1);
+      __m128 lam  = _mm_loadu_ps(lambda + i);
+      __m128 cj   = _mm_sub_ps(d, rest);                                                                  // Cj(x)
+      __m128 dl   = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), cj), _mm_mul_ps(va, lam)),
+                               _mm_add_ps(w, va));                                                        // eq.18
+      __m128 live = _mm_cmpge_ps(w, eps);
+      dl          = _mm_and_ps(dl, live);
+      vres        = _mm_max_ps(vres, _mm_and_ps(_mm_andnot_ps(sign, _mm_add_ps(cj, _mm_mul_ps(va, lam))), live));
+      _mm_storeu_ps(lambda + i, _mm_add_ps(lam, dl));
+      __m128 s    = _mm_div_ps(dl, _mm_add_ps(d, eps));                                                  // eq.17
+      __m128 cx   = _mm_mul_ps(s, gx);
+      __m128 cy   = _mm_mul_ps(s, gy);
+      __m128 cz   = _mm_mul_ps(s, gz);
+      _mm_store_ps(x0, _mm_add_ps(vx0, _mm_mul_ps(cx, w0)));
+      _mm_store_ps(y0, _mm_add_ps(vy0, _mm_mul_ps(cy, w0)));
+      _mm_store_ps(z0, _mm_add_ps(vz0, _mm_mul_ps(cz, w0)));
+      _mm_store_ps(x1, _mm_sub_ps(vx1, _mm_mul_ps(cx, w1)));
+      _mm_store_ps(y1, _mm_sub_ps(vy1, _mm_mul_ps(cy, w1)));
+      _mm_store_ps(z1, _mm_sub_ps(vz1, _mm_mul_ps(cz, w1)));
+      for (int k = 0; k < 4; k++) {
+        px[b[k].idx0] = x0[k]; py[b[k].idx0] = y0[k]; pz[b[k].idx0] = z0[k];
+        px[b[k].idx1] = x1[k]; py[b[k].idx1] = y1[k]; pz[b[k].idx1] = z1[k];
+      }
+    }
+    alignas(16) float r[4];
+    _mm_store_ps(r, vres);
+    for (int k = 0; k < 4; k++) {
+      residual = std::max(residual, r[k]);
+    }
+    return n;
+  }
+
+  int SolveDihedralSimd(const DihedralConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    const __m128  va   = _mm_set1_ps(alpha);
+    const __m128  eps  = _mm_set1_ps(FLT_EPSILON);
+    const __m128  sign = _mm_set1_ps(-0.0f);
+    __m128        vres = _mm_setzero_ps();
+    float*        px   = points.pos_x.data();
+    float*        py   = points.pos_y.data();
+    float*        pz   = points.pos_z.data();
+    const float*  im   = points.inv_mass.data();
+    alignas(16) float nx[4][4], ny[4][4], nz[4][4], nl[3][4];
+    int n = count & ~3;
+    for (int i = 0; i < n; i += 4) {
+      const DihedralConstraint<float>* b = c + i;
+      __m128 k[4], w[4], x[4], y[4], z[4];
+      __m128 vx = _mm_setzero_ps(), vy = _mm_setzero_ps(), vz = _mm_setzero_ps(), sum_w = _mm_setzero_ps();
+      for (int j = 0; j < 4; j++) {
+        std::uint32_t a0 = b[0].idx[j], a1 = b[1].idx[j], a2 = b[2].idx[j], a3 = b[3].idx[j];
+        k[j]  = _mm_setr_ps(b[0].k[j], b[1].k[j], b[2].k[j], b[3].k[j]);
+        w[j]  = _mm_setr_ps(im[a0], im[a1], im[a2], im[a3]);
+        x[j]  = _mm_setr_ps(px[a0], px[a1], px[a2], px[a3]);
+        y[j]  = _mm_setr_ps(py[a0], py[a1], py[a2], py[a3]);
+        z[j]  = _mm_setr_ps(pz[a0], pz[a1], pz[a2], pz[a3]);
+        vx    = _mm_add_ps(vx, _mm_mul_ps(k[j], x[j]));
+        vy    = _mm_add_ps(vy, _mm_mul_ps(k[j], y[j]));
+        vz    = _mm_add_ps(vz, _mm_mul_ps(k[j], z[j]));
+        sum_w = _mm_add_ps(sum_w, _mm_mul_ps(w[j], _mm_mul_ps(k[j], k[j])));
+      }
+      __m128 v[3] = { vx, vy, vz }, dl[3];
+      __m128 den  = _mm_add_ps(sum_w, va);
+      __m128 live = _mm_cmpge_ps(sum_w, eps);
+      float* lb   = lambda + 3 * i;
+      for (int d = 0; d < 3; d++) {
+        __m128 lam = _mm_setr_ps(lb[d], lb[3 + d], lb[6 + d], lb[9 + d]);
+        __m128 num = _mm_add_ps(v[d], _mm_mul_ps(va, lam));                                             // C_d(x) + a~ lambda_d
+        dl[d]      = _mm_and_ps(_mm_div_ps(_mm_sub_ps(_mm_setzero_ps(), num), den), live);              // eq.18
+        vres       = _mm_max_ps(vres, _mm_and_ps(_mm_andnot_ps(sign, num), live));
+        _mm_store_ps(nl[d], _mm_add_ps(lam, dl[d]));
+      }
+      for (int l = 0; l < 4; l++) {
+        for (int d = 0; d < 3; d++) {
+          lb[3 * l + d] = nl[d][l];
+        }
+      }
+      for (int j = 0; j < 4; j++) {
+        __m128 f = _mm_mul_ps(w[j], k[j]);                                                              // eq.17
+        _mm_store_ps(nx[j], _mm_add_ps(x[j], _mm_mul_ps(f, dl[0])));
+        _mm_store_ps(ny[j], _mm_add_ps(y[j], _mm_mul_ps(f, dl[1])));
+        _mm_store_ps(nz[j], _mm_add_ps(z[j], _mm_mul_ps(f, dl[2])));
+      }
+      for (int l = 0; l < 4; l++) {
+        for (int j = 0; j < 4; j++) {
+          px[b[l].idx[j]] = nx[j][l]; py[b[l].idx[j]] = ny[j][l]; pz[b[l].idx[j]] = nz[j][l];
+        }
+      }
+    }
+    alignas(16) float r[4];
+    _mm_store_ps(r, vres);
+    for (int l = 0; l < 4; l++) {
+      residual = std::max(residual, r[l]);
+    }
+    return n;
+  }
+
+  int SolveVolumeSimd(const VolumeConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    const __m128  va    = _mm_set1_ps(alpha);
+    const __m128  eps   = _mm_set1_ps(FLT_EPSILON * FLT_EPSILON);
+    const __m128  sign  = _mm_set1_ps(-0.0f);
+    const __m128  sixth = _mm_set1_ps(1.0f / 6.0f);
+    __m128        vres  = _mm_setzero_ps();
+    float*        px    = points.pos_x.data();
+    float*        py    = points.pos_y.data();
+    float*        pz    = points.pos_z.data();
+    const float*  im    = points.inv_mass.data();
+    alignas(16) float nx[4][4], ny[4][4], nz[4][4];
+    int n = count & ~3;
+    for (int i = 0; i < n; i += 4) {
+      const VolumeConstraint<float>* b = c + i;
+      __m128 w[4], x[4], y[4], z[4];
+      for (int j = 0; j < 4; j++) {
+        std::uint32_t a0 = b[0].idx[j], a1 = b[1].idx[j], a2 = b[2].idx[j], a3 = b[3].idx[j];
+        w[j] = _mm_setr_ps(im[a0], im[a1], im[a2], im[a3]);
+        x[j] = _mm_setr_ps(px[a0], px[a1], px[a2], px[a3]);
+        y[j] = _mm_setr_ps(py[a0], py[a1], py[a2], py[a3]);
+        z[j] = _mm_setr_ps(pz[a0], pz[a1], pz[a2], pz[a3]);
+      }
+      __m128 rest = _mm_setr_ps(b[0].rest_volume, b[1].rest_volume, b[2].rest_volume, b[3].rest_volume);
+      __m128 ex[4], ey[4], ez[4], gx[4], gy[4], gz[4];
+      for (int j = 1; j < 4; j++) {
+        ex[j] = _mm_sub_ps(x[j], x[0]);
+        ey[j] = _mm_sub_ps(y[j], y[0]);
+        ez[j] = _mm_sub_ps(z[j], z[0]);
+      }
+      for (int j = 1; j < 4; j++) {
+        int j1 = (j % 3) + 1, j2 = ((j + 1) % 3) + 1;
+        gx[j] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ey[j1], ez[j2]), _mm_mul_ps(ez[j1], ey[j2])), sixth);
+        gy[j] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ez[j1], ex[j2]), _mm_mul_ps(ex[j1], ez[j2])), sixth);
+        gz[j] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ex[j1], ey[j2]), _mm_mul_ps(ey[j1], ex[j2])), sixth);
+      }
+      gx[0] = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_add_ps(gx[1], gx[2]), gx[3]));
+      gy[0] = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_add_ps(gy[1], gy[2]), gy[3]));
+      gz[0] = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_add_ps(gz[1], gz[2]), gz[3]));
+      __m128 sum_w = _mm_setzero_ps();
+      for (int j = 0; j < 4; j++) {
+        __m128 g2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx[j], gx[j]), _mm_mul_ps(gy[j], gy[j])), _mm_mul_ps(gz[j], gz[j]));
+        sum_w     = _mm_add_ps(sum_w, _mm_mul_ps(w[j], g2));
+      }
+      __m128 vol  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex[3], gx[3]), _mm_mul_ps(ey[3], gy[3])), _mm_mul_ps(ez[3], gz[3]));
+      __m128 cj   = _mm_sub_ps(vol, rest);                                                                // Cj(x)
+      __m128 lam  = _mm_loadu_ps(lambda + i);
+      __m128 dl   = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), cj), _mm_mul_ps(va, lam)),
+                               _mm_add_ps(sum_w, va));                                                   // eq.18
+      __m128 live = _mm_cmpge_ps(sum_w, eps);
+      dl          = _mm_and_ps(dl, live);
+      vres        = _mm_max_ps(vres, _mm_and_ps(_mm_andnot_ps(sign, _mm_add_ps(cj, _mm_mul_ps(va, lam))), live));
+      _mm_storeu_ps(lambda + i, _mm_add_ps(lam, dl));
+      for (int j = 0; j < 4; j++) {
+        __m128 f = _mm_mul_ps(dl, w[j]);                                                                // eq.17
+        _mm_store_ps(nx[j], _mm_add_ps(x[j], _mm_mul_ps(f, gx[j])));
+        _mm_store_ps(ny[j], _mm_add_ps(y[j], _mm_mul_ps(f, gy[j])));
+        _mm_store_ps(nz[j], _mm_add_ps(z[j], _mm_mul_ps(f, gz[j])));
+      }
+      for (int l = 0; l < 4; l++) {
+        for (int j = 0; j < 4; j++) {
+          px[b[l].idx[j]] = nx[j][l]; py[b[l].idx[j]] = ny[j][l]; pz[b[l].idx[j]] = nz[j][l];
+        }
+      }
+    }
+    alignas(16) float r[4];
+    _mm_store_ps(r, vres);
+    for (int l = 0; l < 4; l++) {
+      residual = std::max(residual, r[l]);
+    }
+    return n;
+  }
+
+  int SolveNeoHookeanSimd(const DeviatoricConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    return SolveNeoHookean4(c, lambda, count, points, alpha, residual);
+  }
+
+  int SolveNeoHookeanSimd(const HydrostaticConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+    return SolveNeoHookean4(c, lambda, count, points, alpha, residual);
+  }
+};
+
+int SolveDistanceSimd(const DistanceConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+#if defined(XPBD_AVX2)
+  if (UseAvx2()) {
+    return avx2::SolveDistanceSimd(c, lambda, count, points, alpha, residual);
+  }
+#endif
+  return sse2::SolveDistanceSimd(c, lambda, count, points, alpha, residual);
+}
+
+int SolveDihedralSimd(const DihedralConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+#if defined(XPBD_AVX2)
+  if (UseAvx2()) {
+    return avx2::SolveDihedralSimd(c, lambda, count, points, alpha, residual);
+  }
+#endif
+  return sse2::SolveDihedralSimd(c, lambda, count, points, alpha, residual);
+}
+
+int SolveVolumeSimd(const VolumeConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+#if defined(XPBD_AVX2)
+  if (UseAvx2()) {
+    return avx2::SolveVolumeSimd(c, lambda, count, points, alpha, residual);
+  }
+#endif
+  return sse2::SolveVolumeSimd(c, lambda, count, points, alpha, residual);
+}
+
+int SolveNeoHookeanSimd(const DeviatoricConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+#if defined(XPBD_AVX2)
+  if (UseAvx2()) {
+    return avx2::SolveNeoHookeanSimd(c, lambda, count, points, alpha, residual);
+  }
+#endif
+  return sse2::SolveNeoHookeanSimd(c, lambda, count, points, alpha, residual);
+}
+
+int SolveNeoHookeanSimd(const HydrostaticConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual) {
+#if defined(XPBD_AVX2)
+  if (UseAvx2()) {
+    return avx2::SolveNeoHookeanSimd(c, lambda, count, points, alpha, residual);
+  }
+#endif
+  return sse2::SolveNeoHookeanSimd(c, lambda, count, points, alpha, residual);
+}
+#else
+int SolveDistanceSimd(const DistanceConstraint<float>*, float*, int, Points<float>&, float, float&) {
+  return 0; // scalar path handles everything
+}
+
+int SolveDihedralSimd(const DihedralConstraint<float>*, float*, int, Points<float>&, float, float&) {
+  return 0;
+}
+
+int SolveVolumeSimd(const VolumeConstraint<float>*, float*, int, Points<float>&, float, float&) {
+  return 0;
+}
+int SolveNeoHookeanSimd(const DeviatoricConstraint<float>*, float*, int, Points<float>&, float, float&) {
+  return 0;
+}
+
+int SolveNeoHookeanSimd(const HydrostaticConstraint<float>*, float*, int, Points<float>&, float, float&) {
+  return 0;
+}
+#endif
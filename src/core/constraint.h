@@ -0,0 +1,278 @@
+#pragma once
+
+#include "core/points.h"
+#include <cmath>
+#include <algorithm>
+
+// hot data only, lambda is kept in a separate per step array by the owner, NUM_LAMBDA consecutive entries per constraint.
+// Lambda is the accumulator type of that array, double lambdas over float positions give the mixed mode
+template<typename Real>
+class DistanceConstraint {
+public:
+  typedef glm::vec<3, Real> Vec3;
+  static const int NUM_POINT  = 2;
+  static const int NUM_LAMBDA = 1;
+  std::uint32_t idx0;
+  std::uint32_t idx1;
+  Real          rest_length;
+  std::uint32_t  Point(int k) const { return (k == 0) ? idx0 : idx1; }
+  std::uint32_t& Point(int k)       { return (k == 0) ? idx0 : idx1; }
+  DistanceConstraint(const Points<Real>& points, std::uint32_t i0, std::uint32_t i1) : idx0(i0), idx1(i1), rest_length((Real)0.0) {
+    rest_length = glm::length(points.Position(idx1) - points.Position(idx0));
+  }
+  // alpha : compliance / dt^2 (a~), returns the correction for point0 before inverse mass scaling
+  // residual : |Cj(x) + a~ lambda| before the update, the numerator of eq.18
+  template<typename Lambda>
+  Vec3 Correction(const Points<Real>& points, Lambda& lambda, Real alpha, Real& residual) const {
+    Real w = points.inv_mass[idx0] + points.inv_mass[idx1];
+    if (w < FLT_EPSILON) {
+      residual = (Real)0.0;
+      return Vec3((Real)0.0);
+    }
+    Vec3   grad = points.Position(idx0) - points.Position(idx1);
+    Real      d = glm::length(grad);
+    Real   constraint = d - rest_length;                                                      // Cj(x)
+    Lambda numerator  = (Lambda)constraint + (Lambda)alpha * lambda;
+    Lambda dlambda    = -numerator / ((Lambda)w + (Lambda)alpha);                              // eq.18
+    residual = (Real)std::abs(numerator);
+    lambda  += dlambda;
+    return (Real)dlambda * grad / (d + (Real)FLT_EPSILON);                                     // eq.17
+  }
+  template<typename Lambda>
+  Real SolvePosition(Points<Real>& points, Lambda* lambda, Real alpha) const {
+    Real residual;
+    Vec3 corr = Correction(points, *lambda, alpha, residual);
+    Real w0   = points.inv_mass[idx0];
+    Real w1   = points.inv_mass[idx1];
+    points.pos_x[idx0] += corr.x * w0;
+    points.pos_y[idx0] += corr.y * w0;
+    points.pos_z[idx0] += corr.z * w0;
+    points.pos_x[idx1] -= corr.x * w1;
+    points.pos_y[idx1] -= corr.y * w1;
+    points.pos_z[idx1] -= corr.z * w1;
+    return residual;
+  }
+};
+
+// batched eq.17/eq.18 over constraints of one color (no shared particle), returns how many were projected.
+// residual is raised to the largest |Cj(x) + a~ lambda| seen. only float/float has a vector kernel,
+// the other precisions project nothing here and leave everything to the scalar path
+int SolveDistanceSimd(const DistanceConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual);
+template<typename Real, typename Lambda>
+inline int SolveDistanceSimd(const DistanceConstraint<Real>*, Lambda*, int, Points<Real>&, Real, Real&) {
+  return 0;
+}
+
+// isometric bending (Bergou 2006, Discrete Quadratic Curvature Energies) over the hinge of two triangles,
+// idx[0]-idx[1] is the shared edge, idx[2] and idx[3] the opposite corners. assumes a flat rest state.
+// one linear constraint per axis, C_d(x) = sum k_i x_i[d] with its own lambda, k is the cotangent stencil scaled by
+// sqrt(3 / (A0 + A1)) so sum_d C_d^2 / 2 is the bending energy and the compliance is an inverse bending stiffness.
+// the gradient of C_d is the constant k_i along axis d, so eq.18 has the denominator sum w_i k_i^2 + a~ on every axis.
+// the norm |sum k_i x_i| would have no gradient at the flat rest state and its residual would never settle
+template<typename Real>
+class DihedralConstraint {
+public:
+  typedef glm::vec<3, Real> Vec3;
+  static const int NUM_POINT  = 4;
+  static const int NUM_LAMBDA = 3;
+  std::uint32_t idx[4];
+  Real          k[4];
+  std::uint32_t  Point(int i) const { return idx[i]; }
+  std::uint32_t& Point(int i)       { return idx[i]; }
+  DihedralConstraint(const Points<Real>& points, std::uint32_t i0, std::uint32_t i1, std::uint32_t i2, std::uint32_t i3) : idx{ i0, i1, i2, i3 }, k() {
+    auto cot = [](const Vec3& a, const Vec3& b) { return glm::dot(a, b) / std::max(glm::length(glm::cross(a, b)), (Real)FLT_EPSILON); };
+    Vec3 e0 = points.Position(i1) - points.Position(i0);
+    Vec3 e1 = points.Position(i2) - points.Position(i0);
+    Vec3 e2 = points.Position(i3) - points.Position(i0);
+    Vec3 e3 = points.Position(i2) - points.Position(i1);
+    Vec3 e4 = points.Position(i3) - points.Position(i1);
+    Real c01 = cot( e0, e1), c02 = cot( e0, e2);
+    Real c03 = cot(-e0, e3), c04 = cot(-e0, e4);
+    Real area  = (Real)0.5 * (glm::length(glm::cross(e0, e1)) + glm::length(glm::cross(e0, e2)));
+    Real scale = std::sqrt((Real)3.0 / std::max(area, (Real)FLT_EPSILON));
+    k[0] = scale * ( c03 + c04);
+    k[1] = scale * ( c01 + c02);
+    k[2] = scale * (-c01 - c03);
+    k[3] = scale * (-c02 - c04);
+  }
+  template<typename Lambda>
+  Real SolvePosition(Points<Real>& points, Lambda* lambda, Real alpha) const {
+    Real w[4], sum_w = (Real)0.0;
+    Vec3 v((Real)0.0);
+    for (int i = 0; i < 4; i++) {
+      w[i]   = points.inv_mass[idx[i]];
+      sum_w += w[i] * k[i] * k[i];
+      v     += k[i] * points.Position(idx[i]);
+    }
+    if (sum_w < FLT_EPSILON) {
+      return (Real)0.0;
+    }
+    Real residual = (Real)0.0;
+    Vec3 dlambda;
+    for (int d = 0; d < 3; d++) {
+      Lambda numerator = (Lambda)v[d] + (Lambda)alpha * lambda[d];                          // C_d(x) + a~ lambda_d
+      Lambda dl        = -numerator / ((Lambda)sum_w + (Lambda)alpha);                        // eq.18
+      lambda[d] += dl;
+      dlambda[d] = (Real)dl;
+      residual   = std::max(residual, (Real)std::abs(numerator));
+    }
+    for (int i = 0; i < 4; i++) {
+      Vec3 corr = (w[i] * k[i]) * dlambda;                                                    // eq.17
+      points.pos_x[idx[i]] += corr.x;
+      points.pos_y[idx[i]] += corr.y;
+      points.pos_z[idx[i]] += corr.z;
+    }
+    return residual;
+  }
+};
+
+// SolveDistanceSimd for hinges, lambda holds the NUM_LAMBDA axes of each record back to back
+int SolveDihedralSimd(const DihedralConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual);
+template<typename Real, typename Lambda>
+inline int SolveDihedralSimd(const DihedralConstraint<Real>*, Lambda*, int, Points<Real>&, Real, Real&) {
+  return 0;
+}
+
+// tetrahedron volume preservation, C(x) = V(x) - V0 with V = (x1-x0)x(x2-x0).(x3-x0) / 6.
+// grad_i for i > 0 is the cross product of the two other edges from x0 over 6, grad_0 is minus their sum
+template<typename Real>
+class VolumeConstraint {
+public:
+  typedef glm::vec<3, Real> Vec3;
+  static const int NUM_POINT  = 4;
+  static const int NUM_LAMBDA = 1;
+  std::uint32_t idx[4];
+  Real          rest_volume;
+  std::uint32_t  Point(int i) const { return idx[i]; }
+  std::uint32_t& Point(int i)       { return idx[i]; }
+  VolumeConstraint(const Points<Real>& points, std::uint32_t i0, std::uint32_t i1, std::uint32_t i2, std::uint32_t i3) : idx{ i0, i1, i2, i3 }, rest_volume((Real)0.0) {
+    rest_volume = Volume(points);
+  }
+  Real Volume(const Points<Real>& points) const {
+    Vec3 x0 = points.Position(idx[0]);
+    return glm::dot(glm::cross(points.Position(idx[1]) - x0, points.Position(idx[2]) - x0), points.Position(idx[3]) - x0) / (Real)6.0;
+  }
+  template<typename Lambda>
+  Real SolvePosition(Points<Real>& points, Lambda* lambda, Real alpha) const {
+    Vec3 x0 = points.Position(idx[0]);
+    Vec3 e1 = points.Position(idx[1]) - x0;
+    Vec3 e2 = points.Position(idx[2]) - x0;
+    Vec3 e3 = points.Position(idx[3]) - x0;
+    Vec3 grad[4];
+    grad[1] = glm::cross(e2, e3) / (Real)6.0;
+    grad[2] = glm::cross(e3, e1) / (Real)6.0;
+    grad[3] = glm::cross(e1, e2) / (Real)6.0;
+    grad[0] = -(grad[1] + grad[2] + grad[3]);
+    Real w[4], sum_w = (Real)0.0;
+    for (int i = 0; i < 4; i++) {
+      w[i]   = points.inv_mass[idx[i]];
+      sum_w += w[i] * glm::dot(grad[i], grad[i]);
+    }
+    if (sum_w < FLT_EPSILON * FLT_EPSILON) { // |grad|^2 scales with length^4, a plain FLT_EPSILON would skip small tets
+      return (Real)0.0;
+    }
+    Real   constraint = glm::dot(e3, grad[3]) - rest_volume;                           // Cj(x)
+    Lambda numerator  = (Lambda)constraint + (Lambda)alpha * *lambda;
+    Lambda dlambda    = -numerator / ((Lambda)sum_w + (Lambda)alpha);                   // eq.18
+    *lambda += dlambda;
+    for (int i = 0; i < 4; i++) {
+      Vec3 corr = ((Real)dlambda * w[i]) * grad[i];                                     // eq.17
+      points.pos_x[idx[i]] += corr.x;
+      points.pos_y[idx[i]] += corr.y;
+      points.pos_z[idx[i]] += corr.z;
+    }
+    return (Real)std::abs(numerator);
+  }
+};
+
+// SolveDistanceSimd for tetrahedra
+int SolveVolumeSimd(const VolumeConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual);
+template<typename Real, typename Lambda>
+inline int SolveVolumeSimd(const VolumeConstraint<Real>*, Lambda*, int, Points<Real>&, Real, Real&) {
+  return 0;
+}
+
+// stable neo-hookean (Macklin 2021, A Constraint-based Formulation of Stable Neo-Hookean Materials) over a tet,
+// F = Ds Dm^-1 with Ds, Dm the edges from x0. Hydrostatic : C(x) = det(F) - gamma, otherwise the deviatoric
+// C(x) = |F|_F. the two parts keep their own lambdas, so they are separate constraint types in separate batches.
+// alpha of the batch is the material compliance 1/E over h^2, scale turns it into 1 / (mu V0) or 1 / (lambda V0).
+// grad_i = (dC/dF) Dm^-T column i for i > 0, grad_0 is minus their sum. the record is 16 words for the vector kernels
+template<typename Real, bool Hydrostatic>
+class NeoHookeanConstraint {
+public:
+  typedef glm::vec<3, Real>    Vec3;
+  typedef glm::mat<3, 3, Real> Mat3;
+  static const int NUM_POINT  = 4;
+  static const int NUM_LAMBDA = 1;
+  std::uint32_t idx[4];
+  Real          inv_rest[9];   // Dm^-1, column major
+  Real          rest_volume;
+  Real          scale;         // a~ = alpha * scale
+  Real          gamma;         // hydrostatic rest value 1 + mu / lambda, keeps the rest state force free
+  std::uint32_t  Point(int i) const { return idx[i]; }
+  std::uint32_t& Point(int i)       { return idx[i]; }
+  // poisson : ratio of the material, E is 1 / compliance, mu = E / 2(1 + poisson), lambda = E poisson / (1 + poisson)(1 - 2 poisson)
+  NeoHookeanConstraint(const Points<Real>& points, std::uint32_t i0, std::uint32_t i1, std::uint32_t i2, std::uint32_t i3, Real poisson) : idx{ i0, i1, i2, i3 }, inv_rest(), rest_volume((Real)0.0), scale((Real)0.0), gamma((Real)0.0) {
+    Vec3 x0 = points.Position(i0);
+    Mat3 dm(points.Position(i1) - x0, points.Position(i2) - x0, points.Position(i3) - x0);
+    Mat3 inv = glm::inverse(dm);
+    for (int c = 0; c < 3; c++) {
+      for (int r = 0; r < 3; r++) {
+        inv_rest[c * 3 + r] = inv[c][r];
+      }
+    }
+    rest_volume = std::abs(glm::determinant(dm)) / (Real)6.0;
+    Real inv_mu     = (Real)2.0 * ((Real)1.0 + poisson);                                      // mu     = E / inv_mu
+    Real inv_lambda = ((Real)1.0 + poisson) * ((Real)1.0 - (Real)2.0 * poisson) / poisson;   // lambda = E / inv_lambda
+    scale = (Hydrostatic ? inv_lambda : inv_mu) / std::max(rest_volume, (Real)FLT_MIN);
+    gamma = (Real)1.0 + inv_lambda / inv_mu;
+  }
+  template<typename Lambda>
+  Real SolvePosition(Points<Real>& points, Lambda* lambda, Real alpha) const {
+    Vec3 x0 = points.Position(idx[0]);
+    Mat3 ds(points.Position(idx[1]) - x0, points.Position(idx[2]) - x0, points.Position(idx[3]) - x0);
+    Mat3 dm_inv(inv_rest[0], inv_rest[1], inv_rest[2], inv_rest[3], inv_rest[4], inv_rest[5], inv_rest[6], inv_rest[7], inv_rest[8]);
+    Mat3 f = ds * dm_inv;
+    Mat3 dcdf;
+    Real constraint;                                                                          // Cj(x)
+    if (Hydrostatic) {
+      constraint = glm::determinant(f) - gamma;
+      dcdf       = Mat3(glm::cross(f[1], f[2]), glm::cross(f[2], f[0]), glm::cross(f[0], f[1]));
+    } else {
+      constraint = std::sqrt(glm::dot(f[0], f[0]) + glm::dot(f[1], f[1]) + glm::dot(f[2], f[2]));
+      dcdf       = f * ((Real)1.0 / std::max(constraint, (Real)FLT_EPSILON));
+    }
+    Mat3 h = dcdf * glm::transpose(dm_inv);
+    Vec3 grad[4] = { -(h[0] + h[1] + h[2]), h[0], h[1], h[2] };
+    Real w[4], sum_w = (Real)0.0;
+    for (int i = 0; i < 4; i++) {
+      w[i]   = points.inv_mass[idx[i]];
+      sum_w += w[i] * glm::dot(grad[i], grad[i]);
+    }
+    if (sum_w < FLT_EPSILON * FLT_EPSILON) {
+      return (Real)0.0;
+    }
+    Real   a         = alpha * scale;
+    Lambda numerator = (Lambda)constraint + (Lambda)a * *lambda;
+    Lambda dlambda   = -numerator / ((Lambda)sum_w + (Lambda)a);                        // eq.18
+    *lambda += dlambda;
+    for (int i = 0; i < 4; i++) {
+      Vec3 corr = ((Real)dlambda * w[i]) * grad[i];                                           // eq.17
+      points.pos_x[idx[i]] += corr.x;
+      points.pos_y[idx[i]] += corr.y;
+      points.pos_z[idx[i]] += corr.z;
+    }
+    return (Real)std::abs(numerator);
+  }
+};
+
+template<typename Real> using DeviatoricConstraint  = NeoHookeanConstraint<Real, false>;
+template<typename Real> using HydrostaticConstraint = NeoHookeanConstraint<Real, true>;
+
+// SolveDistanceSimd for both neo-hookean parts, F and dC/dF of 8 (AVX2) or 4 (SSE2) tets per lane group
+int SolveNeoHookeanSimd(const DeviatoricConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual);
+int SolveNeoHookeanSimd(const HydrostaticConstraint<float>* c, float* lambda, int count, Points<float>& points, float alpha, float& residual);
+template<typename Real, bool Hydrostatic, typename Lambda>
+inline int SolveNeoHookeanSimd(const NeoHookeanConstraint<Real, Hydrostatic>*, Lambda*, int, Points<Real>&, Real, Real&) {
+  return 0;
+}
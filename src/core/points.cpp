@@ -0,0 +1,101 @@
+#include "core/points.h"
+#include <algorithm>
+
+namespace {
+  // spread the low 10 bits of v so there are two zero bits between each
+  std::uint32_t ExpandBits(std::uint32_t v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+  }
+};
+
+template<typename Real>
+std::vector<int> Points<Real>::SpatialOrder() const {
+  const int n = Size();
+  Vec3 lo( FLT_MAX), hi(-FLT_MAX);
+  for (int i = 0; i < n; i++) {
+    lo = glm::min(lo, Position(i));
+    hi = glm::max(hi, Position(i));
+  }
+  Vec3 extent = glm::max(hi - lo, Vec3((Real)FLT_EPSILON));
+  Real scale  = (Real)1023.0 / std::max(extent.x, std::max(extent.y, extent.z)); // uniform, a flat cloth keeps its aspect
+  std::vector<std::uint32_t> code(n);
+  for (int i = 0; i < n; i++) {
+    glm::uvec3 q((Position(i) - lo) * scale);
+    code[i] = (ExpandBits(q.x) << 2) | (ExpandBits(q.y) << 1) | ExpandBits(q.z);
+  }
+  std::vector<int> order(n);
+  for (int i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return code[a] < code[b]; });
+  return order;
+}
+
+template<typename Real>
+void Points<Real>::Permute(const std::vector<int>& order) {
+  AlignedVector<Real> tmp(order.size());
+  for (auto* v : { &inv_mass, &pos_x, &pos_y, &pos_z, &prev_x, &prev_y, &prev_z, &vel_x, &vel_y, &vel_z }) {
+    for (size_t i = 0; i < order.size(); i++) {
+      tmp[i] = (*v)[order[i]];
+    }
+    v->swap(tmp);
+  }
+}
+
+template<typename Real>
+void Points<Real>::Predict(Real dt, int begin, int end) {
+  const Real* w  = inv_mass.data();
+  Real*       px = pos_x.data();  Real* py = pos_y.data();  Real* pz = pos_z.data();
+  Real*       qx = prev_x.data(); Real* qy = prev_y.data(); Real* qz = prev_z.data();
+  Real*       vx = vel_x.data();  Real* vy = vel_y.data();  Real* vz = vel_z.data();
+  for (int i = begin; i < end; i++) {
+    if (w[i] < FLT_EPSILON) {
+      continue;
+    }
+    vx[i]  = px[i] - qx[i];
+    vy[i]  = py[i] - qy[i] - (Real)GRAVITY * dt;
+    vz[i]  = pz[i] - qz[i];
+    qx[i]  = px[i];
+    qy[i]  = py[i];
+    qz[i]  = pz[i];
+    px[i] += vx[i] * dt;
+    py[i] += vy[i] * dt;
+    pz[i] += vz[i] * dt;
+  }
+}
+
+template<typename Real>
+void Points<Real>::Integrate(Real h, int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    if (inv_mass[i] < FLT_EPSILON) {
+      continue;
+    }
+    vel_y[i]  -= (Real)GRAVITY * h;
+    prev_x[i]  = pos_x[i];
+    prev_y[i]  = pos_y[i];
+    prev_z[i]  = pos_z[i];
+    pos_x[i]  += vel_x[i] * h;
+    pos_y[i]  += vel_y[i] * h;
+    pos_z[i]  += vel_z[i] * h;
+  }
+}
+
+template<typename Real>
+void Points<Real>::UpdateVelocity(Real h, int begin, int end) {
+  const Real inv_h = (Real)1.0 / h;
+  for (int i = begin; i < end; i++) {
+    if (inv_mass[i] < FLT_EPSILON) {
+      continue;
+    }
+    vel_x[i] = (pos_x[i] - prev_x[i]) * inv_h;
+    vel_y[i] = (pos_y[i] - prev_y[i]) * inv_h;
+    vel_z[i] = (pos_z[i] - prev_z[i]) * inv_h;
+  }
+}
+
+template class Points<float>;
+template class Points<double>;
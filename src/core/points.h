@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core/common.h"
+#include <initializer_list>
+
+// structure of arrays, each component lives in its own 32 byte aligned stream
+template<typename Real>
+class Points {
+public:
+  typedef glm::vec<3, Real> Vec3;
+  AlignedVector<Real> inv_mass;
+  AlignedVector<Real> pos_x,  pos_y,  pos_z;
+  AlignedVector<Real> prev_x, prev_y, prev_z;
+  AlignedVector<Real> vel_x,  vel_y,  vel_z;
+  Points() : inv_mass(), pos_x(), pos_y(), pos_z(), prev_x(), prev_y(), prev_z(), vel_x(), vel_y(), vel_z() {}
+  int  Size() const { return (int)inv_mass.size(); }
+  Vec3 Position(int i) const { return Vec3(pos_x[i], pos_y[i], pos_z[i]); }
+  void Reserve(int n) {
+    for (auto* v : { &inv_mass, &pos_x, &pos_y, &pos_z, &prev_x, &prev_y, &prev_z, &vel_x, &vel_y, &vel_z }) {
+      v->reserve(n);
+    }
+  }
+  void Clear() {
+    for (auto* v : { &inv_mass, &pos_x, &pos_y, &pos_z, &prev_x, &prev_y, &prev_z, &vel_x, &vel_y, &vel_z }) {
+      v->clear();
+      v->shrink_to_fit();
+    }
+  }
+  void Add(Real inv_m, const Vec3& pos, const Vec3& vel) {
+    inv_mass.push_back(inv_m);
+    pos_x.push_back(pos.x);  pos_y.push_back(pos.y);  pos_z.push_back(pos.z);
+    prev_x.push_back(pos.x); prev_y.push_back(pos.y); prev_z.push_back(pos.z);
+    vel_x.push_back(vel.x);  vel_y.push_back(vel.y);  vel_z.push_back(vel.z);
+  }
+  // point order along a morton curve over the bounding box, order[i] is the old index of new point i
+  std::vector<int> SpatialOrder() const;
+  // new point i takes old point order[i]
+  void Permute(const std::vector<int>& order);
+  void Predict(Real dt, int begin, int end);
+  // substep integration, velocity is a real velocity here (see UpdateVelocity)
+  void Integrate(Real h, int begin, int end);
+  void UpdateVelocity(Real h, int begin, int end);
+};
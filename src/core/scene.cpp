@@ -0,0 +1,20 @@
+#include "core/scene.h"
+
+template<typename Real>
+void FillVertexBuffer(const Points<Real>& points, const std::vector<std::uint32_t>& triangles, const std::vector<glm::vec<3, Real>>& normals, std::vector<float>& out) {
+  out.resize(triangles.size() * 6);
+  float* dst = out.data();
+  for(auto i : triangles) {
+    const glm::vec<3, Real>& n = normals[i];
+    dst[0] = (float)n.x;
+    dst[1] = (float)n.y;
+    dst[2] = (float)n.z;
+    dst[3] = (float)points.pos_x[i];
+    dst[4] = (float)points.pos_y[i];
+    dst[5] = (float)points.pos_z[i];
+    dst += 6;
+  }
+}
+
+template void FillVertexBuffer(const Points<float>&,  const std::vector<std::uint32_t>&, const std::vector<glm::vec<3, float>>&,  std::vector<float>&);
+template void FillVertexBuffer(const Points<double>&, const std::vector<std::uint32_t>&, const std::vector<glm::vec<3, double>>&, std::vector<float>&);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "core/points.h"
+#include <thread>
+#include <algorithm>
+
+class ThreadPool;
+class Colliders;
+
+// per constraint type settings, indexed by eConstraint
+struct BatchParams {
+  float               compliance;      // < 0 : Params::compliance
+  int                 num_iteration;   // solver passes that include the batch, 0 : all of them
+  int                 interval;        // solve on every interval-th pass only
+  BatchParams() : compliance(-1.0f), num_iteration(0), interval(1) {}
+  bool  Solve(int pass) const { return ((num_iteration <= 0) || (pass < num_iteration)) && ((pass % std::max(interval, 1)) == 0); }
+};
+
+// simulation parameters, everything the solver reads each step
+struct Params {
+  ThreadPool*         thread_pool;     // nullptr : run serially
+  int                 num_thread;
+  int                 integrator;
+  int                 num_iteration;
+  int                 num_substep;
+  int                 mat_compliance;
+  float               compliance;
+  int                 solver;
+  float               relaxation;      // jacobi only
+  bool                chebyshev;       // iterations only, accelerate the solver passes of one step
+  float               spectral_radius; // chebyshev, 0 : estimate every step
+  float               tolerance;       // iterations only, stop once max |C + a~ lambda| of a pass falls below, 0 : never
+  BatchParams         batch[eConstraint_Max];
+  const Colliders*    colliders;       // nullptr : nothing to collide with
+  bool                self_collision;  // cloth layers keep apart, contacts are found once per step
+  bool                ccd;             // continuous collision of the prediction against colliders and, with self_collision, the cloth itself
+  bool                sleep;           // tiles of points that stay still are neither predicted nor solved until something moves them
+  float               sleep_velocity;  // sleep : speed below which a tile counts as still
+  float               sleep_error;     // sleep : largest |C + a~ lambda| of the last pass a still tile may keep, 0 : speed alone decides
+  Params() : thread_pool(nullptr), num_thread((int)std::max(1u, std::thread::hardware_concurrency())), integrator(eIntegrator_Iteration), num_iteration(20), num_substep(20), mat_compliance(eMat_Fat), compliance((Float)MAT_COMPLIANCE[mat_compliance]), solver(eSolver_GaussSeidel), relaxation(1.5f), chebyshev(false), spectral_radius(0.0f), tolerance(0.0f), batch(), colliders(nullptr), self_collision(false), ccd(false), sleep(false), sleep_velocity(0.01f), sleep_error(0.0f) {}
+};
+
+// what the solver did in the last step, for display
+struct SolverStats {
+  int                 num_iteration;   // solver passes of the last step
+  float               residual;        // max |C + a~ lambda| seen by the last pass
+  float               spectral_radius; // chebyshev rho used by the last step
+  int                 num_sleeping;    // points asleep after the last step
+  SolverStats() : num_iteration(0), residual(0.0f), spectral_radius(0.0f), num_sleeping(0) {}
+};
+
+class Scene {
+protected:
+  SolverStats stats;
+public:
+  enum {
+    eCloth,
+    eSoftBody,
+    eNum,
+  };
+  virtual void Update(Params& params, Float dt) = 0;
+  // interleaved normal xyz, position xyz per triangle corner (GL_N3F_V3F layout), always float whatever the solver precision
+  virtual void FillVertexBuffer(std::vector<float>& out) const = 0;
+  // nearest triangle hit by origin + dir * t and the corner of it closest to the hit, false if the ray misses
+  virtual bool Pick(const glm::vec3&, const glm::vec3&, float&, int&) const { return false; }
+  // point follows pos as if pinned until Release, one point at a time
+  virtual void Grab(int, const glm::vec3&) {}
+  virtual void Release() {}
+  // everything asleep moves again, for changes the scene cannot see such as colliders
+  virtual void Wake() {}
+  const SolverStats&  GetStats() const { return stats; }
+  virtual ~Scene() {}
+};
+
+// FillVertexBuffer of a scene whose triangles index points and normals
+template<typename Real>
+void FillVertexBuffer(const Points<Real>& points, const std::vector<std::uint32_t>& triangles, const std::vector<glm::vec<3, Real>>& normals, std::vector<float>& out);
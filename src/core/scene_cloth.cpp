@@ -0,0 +1,258 @@
+#include "core/scene_cloth.h"
+#include <map>
+
+template<typename Real, typename Lambda>
+void SceneCloth<Real, Lambda>::MakeBendConstraints() {
+  std::map<std::pair<std::uint32_t, std::uint32_t>, std::uint32_t> edges; // edge -> opposite corner of the first triangle seen
+  for(size_t f = 0; f + 2 < triangles.size(); f += 3) {
+    for(int k = 0; k < 3; k++) {
+      std::uint32_t p0  = triangles[f + k];
+      std::uint32_t p1  = triangles[f + (k + 1) % 3];
+      std::uint32_t opp = triangles[f + (k + 2) % 3];
+      auto key = std::make_pair(std::min(p0, p1), std::max(p0, p1));
+      auto it  = edges.find(key);
+      if (it == edges.end()) {
+        edges[key] = opp;
+      } else {
+        bends.push_back(DihedralConstraint<Real>(points, key.first, key.second, it->second, opp));
+      }
+    }
+  }
+}
+
+template<typename Real, typename Lambda>
+void SceneCloth<Real, Lambda>::BuildAdjacency() {
+  adj_offsets.assign(points.Size() + 1, 0);
+  for(const auto& c : constraints) {
+    adj_offsets[c.idx0 + 1]++;
+    adj_offsets[c.idx1 + 1]++;
+  }
+  for(int i = 0; i < points.Size(); i++) {
+    adj_offsets[i + 1] += adj_offsets[i];
+  }
+  adj_constraints.resize(adj_offsets.back());
+  std::vector<int> cursor(adj_offsets.begin(), adj_offsets.end() - 1);
+  for(int c = 0; c < (int)constraints.size(); c++) {
+    adj_constraints[cursor[constraints[c].idx0]++] =  c;
+    adj_constraints[cursor[constraints[c].idx1]++] = ~c;
+  }
+  corr_x.resize(constraints.size());
+  corr_y.resize(constraints.size());
+  corr_z.resize(constraints.size());
+}
+
+template<typename Real, typename Lambda>
+Real SceneCloth<Real, Lambda>::SolveConstraintsJacobi(const Params& params, const Real* alpha, int pass) {
+  const int   MIN_GRAIN  = 256;
+  ThreadPool* pool       = params.thread_pool;
+  Real        relaxation = (Real)params.relaxation;
+  bool        active[eConstraint_Max];
+  for(int t = 0; t < eConstraint_Max; t++) {
+    active[t] = params.batch[t].Solve(pass);
+  }
+  auto is_active = [&](int c) {
+    for(int t = 0; t < eConstraint_Max; t++) {
+      if (c < batches[t].end) {
+        return active[t];
+      }
+    }
+    return false;
+  };
+  auto average = [&](int begin, int end) {
+    for(int i = begin; i < end; i++) {
+      int  num = 0;
+      Vec3 sum((Real)0.0);
+      for(int k = adj_offsets[i]; k < adj_offsets[i + 1]; k++) {
+        int c = adj_constraints[k];
+        if (!is_active((c >= 0) ? c : ~c)) {
+          continue;
+        }
+        if (c >= 0) {
+          sum += Vec3(corr_x[c], corr_y[c], corr_z[c]);
+        } else {
+          sum -= Vec3(corr_x[~c], corr_y[~c], corr_z[~c]);
+        }
+        num++;
+      }
+      if (num == 0) {
+        continue;
+      }
+      Real scale = relaxation * points.inv_mass[i] / (Real)num;
+      points.pos_x[i] += sum.x * scale;
+      points.pos_y[i] += sum.y * scale;
+      points.pos_z[i] += sum.z * scale;
+    }
+  };
+  auto max      = [](Real a, Real b) { return std::max(a, b); };
+  Real residual = (Real)0.0;
+  for(int t = 0; t < eConstraint_Bend; t++) {
+    if (!active[t]) {
+      continue;
+    }
+    auto project = [&](int begin, int end) {
+      Real max_residual = (Real)0.0;
+      for(int c = begin; c < end; c++) {
+        Real r;
+        Vec3 corr = constraints[c].Correction(points, lambdas[c], alpha[t], r);
+        corr_x[c] = corr.x;
+        corr_y[c] = corr.y;
+        corr_z[c] = corr.z;
+        max_residual = std::max(max_residual, r);
+      }
+      return max_residual;
+    };
+    if (sleeping) { // corrections of inactive tiles go stale, only awake points gather them and none reaches those
+      residual = std::max(residual, std::max(SolveColors(pool, batches[t], project), project(batches[t].color_offsets.back(), batches[t].end)));
+    } else {
+      residual = std::max(residual, ParallelReduce(pool, batches[t].begin, batches[t].end, MIN_GRAIN, (Real)0.0, project, max));
+    }
+  }
+  if (sleeping) {
+    ForAwake(pool, average);
+  } else {
+    ParallelFor(pool, 0, points.Size(), MIN_GRAIN, average);
+  }
+  if (active[eConstraint_Bend]) { // hinges have no averaging path, their colors run in parallel instead
+    residual = std::max(residual, SolveBatch(pool, batches[eConstraint_Bend], bends.data(), alpha[eConstraint_Bend]));
+  }
+  return residual;
+}
+
+template<typename Real, typename Lambda>
+Real SceneCloth<Real, Lambda>::SolveConstraints(const Params& params, const Real* alpha, int pass) {
+  Real residual = (Real)0.0;
+  for(int t = 0; t < eConstraint_Bend; t++) {
+    if (params.batch[t].Solve(pass)) {
+      residual = std::max(residual, SolveBatch(params.thread_pool, batches[t], constraints.data() + batches[t].begin, alpha[t]));
+    }
+  }
+  if (params.batch[eConstraint_Bend].Solve(pass)) {
+    residual = std::max(residual, SolveBatch(params.thread_pool, batches[eConstraint_Bend], bends.data(), alpha[eConstraint_Bend]));
+  }
+  return residual;
+}
+
+template<typename Real, typename Lambda>
+SceneCloth<Real, Lambda>::SceneCloth(const glm::vec2& width, const glm::ivec2& in_div, const glm::vec3& in_pos) : SceneSolver<Real, Lambda>(), size(in_div.x, in_div.y), constraints(), bends(), adj_offsets(), adj_constraints(), corr_x(), corr_y(), corr_z(), self_collision() {
+  points.Reserve(size.x * size.y);
+  for(int w = 0; w < size.x; w++){
+    for(int h = 0; h < size.y; h++){
+      Vec3 pos( width.x  * ((Real)w/(Real)(size.x-1)) - width.x  * 0.5f,
+                0.0f,
+                width.y * ((Real)h/(Real)(size.y-1)) + width.y * 0.5f );
+      //Vec2 uv((Real)(w) / (size.x - 1), (Real)(h) / (size.y - 1));
+      Real inv_mass = 1.0f;
+      Vec3 vel((Real)0.0, (Real)0.0, (Real)0.0);
+      if ((h == 0) && (w == 0)          ||
+          (h == 0) && (w == size.x - 1)) {
+        inv_mass = 0.0f; // fix only edge point
+      }
+      pos += in_pos;
+      points.Add(inv_mass, pos, vel);
+    }
+  }
+  BeginBatch(eConstraint_Structural);
+  for(int w = 0; w < size.x; w++){
+    for(int h = 0; h < size.y; h++){               // structual constraint
+      if  (w < size.x - 1){ MakeConstraint(GetPoint(w, h), GetPoint(w+1, h  )); }
+      if  (h < size.y - 1){ MakeConstraint(GetPoint(w, h), GetPoint(w,   h+1)); }
+    }
+  }
+  EndBatch(eConstraint_Structural);
+  BeginBatch(eConstraint_Shear);
+  for(int w = 0; w < size.x; w++){
+    for(int h = 0; h < size.y; h++){
+      if ((w < size.x - 1) && (h < size.y - 1) ) { // shear constraint
+        MakeConstraint(GetPoint(w,   h), GetPoint(w+1, h+1));
+        MakeConstraint(GetPoint(w+1, h), GetPoint(w,   h+1));
+      }
+    }
+  }
+  EndBatch(eConstraint_Shear);
+  for(int w = 0; w < size.x - 1; w++){
+    for(int h = 0; h < size.y - 1; h++){
+      for(int p : { GetPoint(w,   h), GetPoint(w, h+1), GetPoint(w+1, h),
+                    GetPoint(w+1, h), GetPoint(w, h+1), GetPoint(w+1, h+1) }) {
+        triangles.push_back((std::uint32_t)p);
+      }
+    }
+  }
+  batches[eConstraint_Bend].begin  = (int)constraints.size();
+  batches[eConstraint_Bend].lambda = (int)constraints.size();
+  MakeBendConstraints();
+  batches[eConstraint_Bend].end    = (int)(constraints.size() + bends.size());
+  ReorderPoints();
+  for(int t = 0; t < eConstraint_Bend; t++) {
+    RemapConstraints(constraints.data() + batches[t].begin, batches[t].end - batches[t].begin);
+  }
+  RemapConstraints(bends.data(), (int)bends.size());
+  for(int t = 0; t < eConstraint_Bend; t++) {
+    ColorConstraints(batches[t], constraints.data() + batches[t].begin);
+  }
+  ColorConstraints(batches[eConstraint_Bend], bends.data());
+  for(int t = 0; t < eConstraint_Bend; t++) {
+    TileConstraints(batches[t], constraints.data() + batches[t].begin);
+  }
+  TileConstraints(batches[eConstraint_Bend], bends.data());
+  BuildAdjacency();
+  lambdas.resize(constraints.size() + bends.size() * DihedralConstraint<Real>::NUM_LAMBDA);
+  BuildFaceAdjacency();
+  BuildTiles();
+  self_collision.Init(points, triangles, std::min(width.x / (Real)(size.x - 1), width.y / (Real)(size.y - 1)) * (Real)0.5);
+}
+
+template<typename Real, typename Lambda>
+SceneCloth<Real, Lambda>::~SceneCloth() {
+  constraints.clear();
+  constraints.shrink_to_fit();
+  bends.clear();
+  bends.shrink_to_fit();
+  adj_offsets.clear();
+  adj_offsets.shrink_to_fit();
+  adj_constraints.clear();
+  adj_constraints.shrink_to_fit();
+  for (auto* v : { &corr_x, &corr_y, &corr_z }) {
+    v->clear();
+    v->shrink_to_fit();
+  }
+}
+
+template<typename Real, typename Lambda>
+Real SceneCloth<Real, Lambda>::SolveIteration(Params& params, const Real* alpha, int pass) {
+  if (params.solver == eSolver_Jacobi) {
+    return SolveConstraintsJacobi(params, alpha, pass);
+  }
+  return SolveConstraints(params, alpha, pass);
+}
+
+template<typename Real, typename Lambda>
+void SceneCloth<Real, Lambda>::SolveCCD(Params& params) {
+  Base::SolveCCD(params); // colliders first, self collision then sees where they stopped the points
+  if (SelfCollides(params)) {
+    self_collision.Sweep(params.thread_pool, points, triangles, SearchTiles(), Base::SLEEP_TILE);
+  }
+}
+
+template<typename Real, typename Lambda>
+void SceneCloth<Real, Lambda>::FindContacts(Params& params) {
+  if (SelfCollides(params)) {
+    self_collision.Find(params.thread_pool, points, triangles, vert_face_offsets, vert_faces, SearchTiles(), Base::SLEEP_TILE);
+  }
+}
+
+template<typename Real, typename Lambda>
+Real SceneCloth<Real, Lambda>::SolveContacts(Params& params) {
+  return SelfCollides(params) ? self_collision.Solve(params.thread_pool, points, triangles) : (Real)0.0;
+}
+
+Scene* NewSceneCloth(int precision, const glm::vec2& width, const glm::ivec2& in_div, const glm::vec3& in_pos) {
+  switch (precision) {
+  case ePrecision_Double: return new SceneCloth<double>(width, in_div, in_pos);
+  case ePrecision_Mixed:  return new SceneCloth<float, double>(width, in_div, in_pos);
+  default:                return new SceneCloth<float>(width, in_div, in_pos);
+  }
+}
+
+template class SceneCloth<float>;
+template class SceneCloth<double>;
+template class SceneCloth<float, double>;
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/scene_solver.h"
+#include "core/self_collision.h"
+
+// size.x * size.y grid pinned at two corners, structural, shear and bend batches. GetRemap maps grid point h * size.x + w
+template<typename Real, typename Lambda = Real>
+class SceneCloth : public SceneSolver<Real, Lambda> {
+  typedef SceneSolver<Real, Lambda> Base;
+  using Base::points;
+  using Base::lambdas;
+  using Base::batches;
+  using Base::triangles;
+  using Base::ReorderPoints;
+  using Base::RemapConstraints;
+  using Base::ColorConstraints;
+  using Base::TileConstraints;
+  using Base::BuildTiles;
+  using Base::SolveColors;
+  using Base::ForAwake;
+  using Base::sleeping;
+  using Base::awake_tiles;
+  using Base::active_tiles;
+  using Base::SolveBatch;
+  using Base::BuildFaceAdjacency;
+  using Base::vert_face_offsets;
+  using Base::vert_faces;
+public:
+  typedef typename Base::Vec3 Vec3;
+private:
+  glm::ivec2                            size;
+  std::vector<DistanceConstraint<Real>> constraints;            // eConstraint batches back to back, each sorted by color
+  std::vector<DihedralConstraint<Real>> bends;                  // eConstraint_Bend, three lambdas each right after the distance constraints
+  std::vector<int>                      adj_offsets;            // jacobi : constraints touching point i are adj_constraints[adj_offsets[i], adj_offsets[i+1])
+  std::vector<int>                      adj_constraints;
+  AlignedVector<Real>                   corr_x, corr_y, corr_z; // jacobi : per constraint correction of point0
+  SelfCollision<Real>                   self_collision;         // layers keep half the grid spacing apart
+  int    GetPoint(int w, int h)  {return h * size.x + w; } // grid order, valid until ReorderPoints
+  void   MakeConstraint(int p1, int p2) { constraints.push_back(DistanceConstraint<Real>(points, (std::uint32_t)p1, (std::uint32_t)p2)); }
+  void   BeginBatch(int type) { batches[type].begin = batches[type].lambda = (int)constraints.size(); }
+  void   EndBatch(int type)   { batches[type].end   = (int)constraints.size(); }
+  // a hinge for every edge shared by two triangles
+  void   MakeBendConstraints();
+  // signed adjacency (~c for point1) lets every point gather its own corrections without write conflicts
+  void   BuildAdjacency();
+  Real   SolveConstraintsJacobi(const Params& params, const Real* alpha, int pass);
+  Real   SolveConstraints(const Params& params, const Real* alpha, int pass);
+  virtual Real SolveIteration(Params& params, const Real* alpha, int pass);
+  // self collision is left out while every tile sleeps, and only the active tiles search while some do
+  bool   SelfCollides(const Params& params) const { return params.self_collision && (!sleeping || !awake_tiles.empty()); }
+  const std::vector<int>* SearchTiles() const { return sleeping ? &active_tiles : nullptr; }
+  virtual void SolveCCD(Params& params);
+  virtual void FindContacts(Params& params);
+  virtual Real SolveContacts(Params& params);
+public:
+  SceneCloth(const glm::vec2& width, const glm::ivec2& in_div, const glm::vec3& in_pos);
+  ~SceneCloth();
+  const std::vector<DistanceConstraint<Real>>& GetConstraints()   const { return constraints; }
+  const std::vector<DihedralConstraint<Real>>& GetBends()         const { return bends; }
+  const SelfCollision<Real>&                   GetSelfCollision() const { return self_collision; }
+};
+
+// SceneCloth of the given ePrecision
+Scene* NewSceneCloth(int precision, const glm::vec2& width, const glm::ivec2& in_div, const glm::vec3& in_pos);
@@ -0,0 +1,252 @@
+#include "core/scene_softbody.h"
+#include <map>
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <limits>
+
+namespace {
+  const Float DENSITY = (Float)1000.0; // kg/m^3, soft tissue is close to water
+
+  // next line that is neither empty nor a '#' comment
+  bool next_line(std::ifstream& in, std::istringstream& line) {
+    std::string s;
+    while (std::getline(in, s)) {
+      size_t p = s.find_first_not_of(" \t\r");
+      if ((p != std::string::npos) && (s[p] != '#')) {
+        line.clear();
+        line.str(s);
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+TetMesh MakeTetBox(const glm::vec3& width, const glm::ivec3& div) {
+  static const int KUHN[6][4] = { // corner bit 1 : +x, 2 : +y, 4 : +z. one tet per axis order, all share corners 0 and 7
+    { 0, 1, 3, 7 }, { 0, 1, 5, 7 }, { 0, 2, 3, 7 }, { 0, 2, 6, 7 }, { 0, 4, 5, 7 }, { 0, 4, 6, 7 },
+  };
+  TetMesh    mesh;
+  glm::ivec3 n    = div + glm::ivec3(1);
+  auto       vert = [&](int x, int y, int z) { return (std::uint32_t)((z * n.y + y) * n.x + x); };
+  mesh.vertices.reserve(n.x * n.y * n.z);
+  for(int z = 0; z < n.z; z++){
+    for(int y = 0; y < n.y; y++){
+      for(int x = 0; x < n.x; x++){
+        mesh.vertices.push_back(width * (glm::vec3(x, y, z) / glm::vec3(div) - 0.5f));
+      }
+    }
+  }
+  mesh.tets.reserve(div.x * div.y * div.z * 6 * 4);
+  for(int z = 0; z < div.z; z++){
+    for(int y = 0; y < div.y; y++){
+      for(int x = 0; x < div.x; x++){
+        for(const auto& tet : KUHN) {
+          for(int c : tet) {
+            mesh.tets.push_back(vert(x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1)));
+          }
+        }
+      }
+    }
+  }
+  return mesh;
+}
+
+bool LoadTetGen(const std::string& path, TetMesh& mesh) {
+  std::string base = path;
+  size_t      dot  = base.find_last_of('.');
+  if ((dot != std::string::npos) && ((base.substr(dot) == ".node") || (base.substr(dot) == ".ele"))) {
+    base.resize(dot);
+  }
+  std::ifstream      node(base + ".node");
+  std::ifstream      ele(base + ".ele");
+  std::istringstream line;
+  int num_vertex = 0, dim = 0, num_tet = 0, num_corner = 0;
+  if (!node || !ele || !next_line(node, line) || !(line >> num_vertex >> dim) || (dim != 3)) {
+    return false;
+  }
+  mesh.vertices.resize(num_vertex);
+  int first = 0; // tetgen numbers from 0 or 1, the first vertex tells which
+  for(int i = 0; i < num_vertex; i++) {
+    int id;
+    if (!next_line(node, line) || !(line >> id >> mesh.vertices[i].x >> mesh.vertices[i].y >> mesh.vertices[i].z)) {
+      return false;
+    }
+    if (i == 0) {
+      first = id;
+    }
+  }
+  if (!next_line(ele, line) || !(line >> num_tet >> num_corner) || (num_corner < 4)) {
+    return false;
+  }
+  mesh.tets.resize(num_tet * 4);
+  for(int t = 0; t < num_tet; t++) {
+    int id, v[4];
+    if (!next_line(ele, line) || !(line >> id >> v[0] >> v[1] >> v[2] >> v[3])) { // second order tets list their corners first
+      return false;
+    }
+    for(int k = 0; k < 4; k++) {
+      if ((v[k] - first < 0) || (v[k] - first >= num_vertex)) {
+        return false;
+      }
+      mesh.tets[t * 4 + k] = (std::uint32_t)(v[k] - first);
+    }
+  }
+  return true;
+}
+
+template<typename Real, typename Lambda>
+void SceneSoftBody<Real, Lambda>::MakeEdges() {
+  static const int EDGE[6][2] = { { 0, 1 }, { 0, 2 }, { 0, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 } };
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> keys;
+  keys.reserve(tets.size() * 6);
+  for(const auto& tet : tets) {
+    for(const auto& e : EDGE) {
+      std::uint32_t p0 = tet.idx[e[0]], p1 = tet.idx[e[1]];
+      keys.push_back(std::make_pair(std::min(p0, p1), std::max(p0, p1)));
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  edges.reserve(keys.size());
+  for(const auto& key : keys) {
+    edges.push_back(DistanceConstraint<Real>(points, key.first, key.second));
+  }
+}
+
+template<typename Real, typename Lambda>
+void SceneSoftBody<Real, Lambda>::MakeNeoHookean() {
+  deviatoric.reserve(tets.size());
+  hydrostatic.reserve(tets.size());
+  for(const auto& tet : tets) {
+    deviatoric.push_back(DeviatoricConstraint<Real>(points, tet.idx[0], tet.idx[1], tet.idx[2], tet.idx[3], (Real)POISSON_RATIO));
+    hydrostatic.push_back(HydrostaticConstraint<Real>(points, tet.idx[0], tet.idx[1], tet.idx[2], tet.idx[3], (Real)POISSON_RATIO));
+  }
+  tets.clear();
+  tets.shrink_to_fit();
+}
+
+template<typename Real, typename Lambda>
+void SceneSoftBody<Real, Lambda>::MakeSurface() {
+  // outward for a positive tet under CalcNormal, which takes cross(v2 - v0, v1 - v0)
+  static const int FACE[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+  std::map<std::array<std::uint32_t, 3>, std::pair<int, std::array<std::uint32_t, 3>>> faces; // sorted corners -> count, wound corners
+  for(const auto& tet : tets) {
+    for(const auto& f : FACE) {
+      std::array<std::uint32_t, 3> wound = { tet.idx[f[0]], tet.idx[f[1]], tet.idx[f[2]] };
+      std::array<std::uint32_t, 3> key   = wound;
+      std::sort(key.begin(), key.end());
+      auto& face = faces[key];
+      face.first++;
+      face.second = wound;
+    }
+  }
+  for(const auto& face : faces) {
+    if (face.second.first == 1) {
+      triangles.insert(triangles.end(), face.second.second.begin(), face.second.second.end());
+    }
+  }
+}
+
+template<typename Real, typename Lambda>
+SceneSoftBody<Real, Lambda>::SceneSoftBody(const TetMesh& mesh, int in_model, const glm::vec3& in_pos) : SceneSolver<Real, Lambda>(), model(in_model), edges(), tets(), deviatoric(), hydrostatic() {
+  const int         num_vertex = (int)mesh.vertices.size();
+  std::vector<Real> mass(num_vertex, (Real)0.0);
+  Real              min_x      = std::numeric_limits<Real>::max();
+  Real              max_x      = std::numeric_limits<Real>::lowest();
+  points.Reserve(num_vertex);
+  for(const auto& v : mesh.vertices) {
+    points.Add((Real)1.0, Vec3(v + in_pos), Vec3((Real)0.0));
+    min_x = std::min(min_x, (Real)v.x);
+    max_x = std::max(max_x, (Real)v.x);
+  }
+  for(size_t t = 0; t + 3 < mesh.tets.size(); t += 4) {
+    VolumeConstraint<Real> tet(points, mesh.tets[t], mesh.tets[t + 1], mesh.tets[t + 2], mesh.tets[t + 3]);
+    if (tet.rest_volume < (Real)0.0) { // keep every tet positive so MakeSurface winds outward
+      std::swap(tet.idx[2], tet.idx[3]);
+      tet.rest_volume = -tet.rest_volume;
+    }
+    for(int k = 0; k < 4; k++) {
+      mass[tet.idx[k]] += (Real)DENSITY * tet.rest_volume * (Real)0.25;
+    }
+    tets.push_back(tet);
+  }
+  Real tolerance = (max_x - min_x) * (Real)1.0e-4;
+  for(int i = 0; i < num_vertex; i++) {
+    bool fixed = ((Real)mesh.vertices[i].x - min_x) <= tolerance;
+    points.inv_mass[i] = (fixed || (mass[i] <= (Real)0.0)) ? (Real)0.0 : (Real)1.0 / mass[i];
+  }
+  MakeSurface();
+  if (model == eTetModel_NeoHookean) {
+    MakeNeoHookean();
+    batches[eConstraint_Deviatoric].begin   = 0;
+    batches[eConstraint_Deviatoric].end     = (int)deviatoric.size();
+    batches[eConstraint_Hydrostatic].begin  = (int)deviatoric.size();
+    batches[eConstraint_Hydrostatic].end    = (int)(deviatoric.size() + hydrostatic.size());
+    batches[eConstraint_Hydrostatic].lambda = batches[eConstraint_Hydrostatic].begin;
+  } else {
+    MakeEdges();
+    batches[eConstraint_Structural].begin   = 0;
+    batches[eConstraint_Structural].end     = (int)edges.size();
+    batches[eConstraint_Volume].begin       = (int)edges.size();
+    batches[eConstraint_Volume].end         = (int)(edges.size() + tets.size());
+    batches[eConstraint_Volume].lambda      = batches[eConstraint_Volume].begin;
+  }
+  ReorderPoints();
+  RemapConstraints(edges.data(),       (int)edges.size());
+  RemapConstraints(tets.data(),        (int)tets.size());
+  RemapConstraints(deviatoric.data(),  (int)deviatoric.size());
+  RemapConstraints(hydrostatic.data(), (int)hydrostatic.size());
+  ColorConstraints(batches[eConstraint_Structural],  edges.data());
+  ColorConstraints(batches[eConstraint_Volume],      tets.data());
+  ColorConstraints(batches[eConstraint_Deviatoric],  deviatoric.data());
+  ColorConstraints(batches[eConstraint_Hydrostatic], hydrostatic.data());
+  lambdas.resize(edges.size() + tets.size() + deviatoric.size() + hydrostatic.size());
+  BuildFaceAdjacency();
+}
+
+template<typename Real, typename Lambda>
+SceneSoftBody<Real, Lambda>::~SceneSoftBody() {
+  edges.clear();
+  edges.shrink_to_fit();
+  tets.clear();
+  tets.shrink_to_fit();
+  deviatoric.clear();
+  deviatoric.shrink_to_fit();
+  hydrostatic.clear();
+  hydrostatic.shrink_to_fit();
+}
+
+template<typename Real, typename Lambda>
+Real SceneSoftBody<Real, Lambda>::SolveIteration(Params& params, const Real* alpha, int pass) {
+  Real residual = (Real)0.0;
+  if (params.batch[eConstraint_Structural].Solve(pass)) {
+    residual = std::max(residual, SolveBatch(params.thread_pool, batches[eConstraint_Structural], edges.data(), alpha[eConstraint_Structural]));
+  }
+  if (params.batch[eConstraint_Volume].Solve(pass)) {
+    residual = std::max(residual, SolveBatch(params.thread_pool, batches[eConstraint_Volume], tets.data(), alpha[eConstraint_Volume]));
+  }
+  if (params.batch[eConstraint_Deviatoric].Solve(pass)) {
+    residual = std::max(residual, SolveBatch(params.thread_pool, batches[eConstraint_Deviatoric], deviatoric.data(), alpha[eConstraint_Deviatoric]));
+  }
+  if (params.batch[eConstraint_Hydrostatic].Solve(pass)) {
+    residual = std::max(residual, SolveBatch(params.thread_pool, batches[eConstraint_Hydrostatic], hydrostatic.data(), alpha[eConstraint_Hydrostatic]));
+  }
+  return residual;
+}
+
+Scene* NewSceneSoftBody(int precision, const TetMesh& mesh, int model, const glm::vec3& in_pos) {
+  if (mesh.tets.empty()) {
+    return nullptr;
+  }
+  switch (precision) {
+  case ePrecision_Double: return new SceneSoftBody<double>(mesh, model, in_pos);
+  case ePrecision_Mixed:  return new SceneSoftBody<float, double>(mesh, model, in_pos);
+  default:                return new SceneSoftBody<float>(mesh, model, in_pos);
+  }
+}
+
+template class SceneSoftBody<float>;
+template class SceneSoftBody<double>;
+template class SceneSoftBody<float, double>;
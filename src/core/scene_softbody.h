@@ -0,0 +1,61 @@
+#pragma once
+
+#include "core/scene_solver.h"
+#include <string>
+
+// tetrahedral mesh before simulation, tets are 4 vertex indices each
+struct TetMesh {
+  std::vector<glm::vec3>     vertices;
+  std::vector<std::uint32_t> tets;
+  TetMesh() : vertices(), tets() {}
+};
+
+// width box of div.x * div.y * div.z cubes centered at the origin, each cube split into 6 tets around its main
+// diagonal (Kuhn), so neighbouring cubes share their face diagonals and the mesh stays conforming
+TetMesh MakeTetBox(const glm::vec3& width, const glm::ivec3& div);
+// TetGen output, path is the base name of the .node/.ele pair (an extension is ignored). false if either file is unreadable
+bool    LoadTetGen(const std::string& path, TetMesh& mesh);
+
+// tet mesh cantilever, points on its min x face are fixed. mass comes from a tissue density over the rest volume.
+// eTetModel_Volume : every tet edge is a distance constraint (eConstraint_Structural) and every tet a volume constraint
+// (eConstraint_Volume). eTetModel_NeoHookean : every tet is a deviatoric and a hydrostatic constraint instead
+template<typename Real, typename Lambda = Real>
+class SceneSoftBody : public SceneSolver<Real, Lambda> {
+  typedef SceneSolver<Real, Lambda> Base;
+  using Base::points;
+  using Base::lambdas;
+  using Base::batches;
+  using Base::triangles;
+  using Base::ReorderPoints;
+  using Base::RemapConstraints;
+  using Base::ColorConstraints;
+  using Base::SolveBatch;
+  using Base::BuildFaceAdjacency;
+public:
+  typedef typename Base::Vec3 Vec3;
+private:
+  int                                      model;             // eTetModel
+  std::vector<DistanceConstraint<Real>>    edges;             // eConstraint_Structural
+  std::vector<VolumeConstraint<Real>>      tets;              // eConstraint_Volume, lambdas right after the edges
+  std::vector<DeviatoricConstraint<Real>>  deviatoric;        // eConstraint_Deviatoric
+  std::vector<HydrostaticConstraint<Real>> hydrostatic;       // eConstraint_Hydrostatic, lambdas right after deviatoric
+  // every edge shared by any number of tets once
+  void   MakeEdges();
+  // both neo-hookean parts of every tet, then clear tets
+  void   MakeNeoHookean();
+  // faces owned by a single tet, wound so CalcNormal points outward
+  void   MakeSurface();
+  // colored gauss-seidel whatever Params::solver says, volume constraints have no jacobi averaging path
+  virtual Real SolveIteration(Params& params, const Real* alpha, int pass);
+public:
+  SceneSoftBody(const TetMesh& mesh, int in_model, const glm::vec3& in_pos);
+  ~SceneSoftBody();
+  const std::vector<DistanceConstraint<Real>>& GetEdges() const { return edges; }
+  const std::vector<VolumeConstraint<Real>>&   GetTets()  const { return tets; }
+  const std::vector<DeviatoricConstraint<Real>>&  GetDeviatoric()  const { return deviatoric; }
+  const std::vector<HydrostaticConstraint<Real>>& GetHydrostatic() const { return hydrostatic; }
+  int    NumTets() const { return (int)(tets.size() + deviatoric.size()); }
+};
+
+// SceneSoftBody of the given ePrecision, nullptr for an empty mesh
+Scene* NewSceneSoftBody(int precision, const TetMesh& mesh, int model, const glm::vec3& in_pos);
@@ -0,0 +1,551 @@
+#include "core/scene_solver.h"
+#include "core/collider.h"
+#include <limits>
+
+namespace {
+  const float SLEEP_TIME = 0.5f; // seconds a tile and its links stay still before it sleeps
+};
+
+template<typename Real, typename Lambda>
+SceneSolver<Real, Lambda>::SceneSolver() : points(), normals(), face_normals(), vert_face_offsets(), vert_faces(), normals_dirty(true), normal_pool(nullptr), bvh(), bvh_dirty(true), grab_point(-1), grab_inv_mass((Real)0.0), tile_adj_offsets(), tile_adj(), tile_links(), tile_sleep(), tile_still(), tile_error(), sleep_inv_mass(), tile_normals(), awake_tiles(), active_tiles(), woken_tiles(), island_tiles(), tile_seen(), tile_frozen(), sleeping(false), lambdas(), batches(), cheb_x(), cheb_y(), cheb_z(), iter_x(), iter_y(), iter_z(), cheb_lambdas(), iter_lambdas(), cheb_ranges(), triangles(), remap() {
+}
+
+template<typename Real, typename Lambda>
+SceneSolver<Real, Lambda>::~SceneSolver() {
+  points.Clear();
+  normals.clear();
+  normals.shrink_to_fit();
+  face_normals.clear();
+  face_normals.shrink_to_fit();
+  vert_face_offsets.clear();
+  vert_face_offsets.shrink_to_fit();
+  vert_faces.clear();
+  vert_faces.shrink_to_fit();
+  tile_adj_offsets.clear();
+  tile_adj_offsets.shrink_to_fit();
+  tile_adj.clear();
+  tile_adj.shrink_to_fit();
+  tile_links.clear();
+  tile_links.shrink_to_fit();
+  for (auto* v : { &tile_sleep, &tile_normals, &tile_seen, &tile_frozen }) {
+    v->clear();
+    v->shrink_to_fit();
+  }
+  tile_still.clear();
+  tile_still.shrink_to_fit();
+  tile_error.clear();
+  tile_error.shrink_to_fit();
+  sleep_inv_mass.clear();
+  sleep_inv_mass.shrink_to_fit();
+  for (auto* v : { &awake_tiles, &active_tiles, &woken_tiles, &island_tiles }) {
+    v->clear();
+    v->shrink_to_fit();
+  }
+  lambdas.clear();
+  lambdas.shrink_to_fit();
+  for(auto& batch : batches) {
+    batch.color_offsets.clear();
+    batch.color_offsets.shrink_to_fit();
+  }
+  for (auto* v : { &cheb_x, &cheb_y, &cheb_z, &iter_x, &iter_y, &iter_z }) {
+    v->clear();
+    v->shrink_to_fit();
+  }
+  for (auto* v : { &cheb_lambdas, &iter_lambdas }) {
+    v->clear();
+    v->shrink_to_fit();
+  }
+  cheb_ranges.clear();
+  cheb_ranges.shrink_to_fit();
+  triangles.clear();
+  triangles.shrink_to_fit();
+  remap.clear();
+  remap.shrink_to_fit();
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::ReorderPoints() {
+  std::vector<int> order = points.SpatialOrder();
+  remap.resize(order.size());
+  for(int i = 0; i < (int)order.size(); i++) {
+    remap[order[i]] = i;
+  }
+  points.Permute(order);
+  for(auto& p : triangles) {
+    p = (std::uint32_t)remap[p];
+  }
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::BatchAlpha(const Params& params, Real h, Real* alpha) const {
+  for(int t = 0; t < eConstraint_Max; t++) {
+    float compliance = (params.batch[t].compliance < 0.0f) ? params.compliance : params.batch[t].compliance;
+    alpha[t] = (Real)compliance / (h * h); // a~
+  }
+}
+
+template<typename Real, typename Lambda>
+Real SceneSolver<Real, Lambda>::SolvePass(Params& params, const Real* alpha, int pass) {
+  if (sleeping) { // a tile keeps the error of the last pass
+    for(int t : active_tiles) {
+      tile_error[t] = (Real)0.0;
+    }
+  }
+  Real residual = std::max(SolveIteration(params, alpha, pass), SolveContacts(params));
+  if ((params.colliders != nullptr) && !params.colliders->Empty()) {
+    auto solve = [&](int begin, int end) { return params.colliders->Solve(points, begin, end); };
+    auto max   = [](Real a, Real b) { return std::max(a, b); };
+    residual = std::max(residual, ReduceAwake(params.thread_pool, (Real)0.0, solve, max));
+  }
+  return residual;
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::SolveCCD(Params& params) {
+  const int MIN_GRAIN = 1024;
+  if ((params.colliders != nullptr) && !params.colliders->Empty()) {
+    ParallelFor(params.thread_pool, 0, points.Size(), MIN_GRAIN, [&](int begin, int end) { params.colliders->Sweep(points, begin, end); });
+  }
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::SolveChebyshev(Params& params, const Real* alpha) {
+  const int   DELAY     = 4;                 // plain passes before the acceleration kicks in, the last two give the rho estimate
+  const Real  MAX_RHO   = (Real)0.999;
+  ThreadPool* pool      = params.thread_pool;
+  const int   n         = points.Size();
+  const int   m         = (int)lambdas.size();
+  for (auto* v : { &cheb_x, &cheb_y, &cheb_z, &iter_x, &iter_y, &iter_z }) {
+    v->resize(n);
+  }
+  cheb_lambdas.resize(m);
+  iter_lambdas.resize(m);
+  cheb_ranges.clear();
+  if (sleeping) { // lambdas of the active tiles and the uncolored rest, the others are never solved and stay 0 all step
+    const int stride = NumTile() + 1;
+    for(const auto& batch : batches) {
+      if (batch.color_offsets.empty()) { // a batch the scene does not use
+        continue;
+      }
+      auto add = [&](int begin, int end) {
+        if (begin < end) {
+          cheb_ranges.push_back(batch.lambda + (begin - batch.begin) * batch.num_lambda);
+          cheb_ranges.push_back(batch.lambda + (end - batch.begin) * batch.num_lambda);
+        }
+      };
+      if (batch.tile_offsets.empty()) {
+        add(batch.begin, batch.end);
+        continue;
+      }
+      for(size_t k = 0; k + 1 < batch.color_offsets.size(); k++) {
+        const int* offsets = &batch.tile_offsets[k * stride];
+        for(int t : active_tiles) {
+          add(offsets[t], offsets[t + 1]);
+        }
+      }
+      add(batch.color_offsets.back(), batch.end);
+    }
+  }
+  auto for_lambdas = [&](auto&& f) { // f(begin, end) over every lambda, only cheb_ranges while sleeping
+    if (!sleeping) {
+      ParallelFor(pool, 0, m, 4096, f);
+      return;
+    }
+    ParallelFor(pool, 0, (int)cheb_ranges.size() / 2, 16, [&](int begin, int end) {
+      for(int r = begin; r < end; r++) {
+        f(cheb_ranges[r * 2], cheb_ranges[r * 2 + 1]);
+      }
+    });
+  };
+  ForAwake(pool, [&](int begin, int end) {
+    std::copy(points.pos_x.begin() + begin, points.pos_x.begin() + end, iter_x.begin() + begin);
+    std::copy(points.pos_y.begin() + begin, points.pos_y.begin() + end, iter_y.begin() + begin);
+    std::copy(points.pos_z.begin() + begin, points.pos_z.begin() + end, iter_z.begin() + begin);
+  });
+  for_lambdas([&](int begin, int end) { std::copy(lambdas.begin() + begin, lambdas.begin() + end, iter_lambdas.begin() + begin); });
+  int    delay    = std::min(DELAY, params.num_iteration);
+  Real   rho      = (params.spectral_radius > 0.0f) ? (Real)params.spectral_radius : (Real)stats.spectral_radius;
+  Real   omega    = (Real)1.0;
+  double norm[2]  = { 0.0, 0.0 };         // squared update of the last two plain passes
+  Real   residual = (Real)0.0;
+  int    num_pass = 0;
+  for(int k = 0; k < params.num_iteration; k++) {
+    residual = SolvePass(params, alpha, k);      // x^ of iteration k+1
+    num_pass = k + 1;
+    if (residual < (Real)params.tolerance) {
+      break;
+    }
+    if (k + 1 == params.num_iteration) { // no blend after the last pass, it would undo its collider projection
+      break;
+    }
+    bool accelerate = (k >= delay) && (k > 0);
+    if (accelerate) {
+      if ((k == delay) && (params.spectral_radius <= 0.0f) && (norm[0] > 0.0)) {
+        rho = (Real)std::min(std::sqrt(norm[1] / norm[0]), (double)MAX_RHO);
+      }
+      omega = (k == delay) ? (Real)2.0 / ((Real)2.0 - rho * rho) : (Real)4.0 / ((Real)4.0 - rho * rho * omega);
+    }
+    // x^(k+1) = omega * (x^ - x^(k-1)) + x^(k-1), then shift the history by one
+    double update = ReduceAwake(pool, 0.0, [&](int begin, int end) { // sleeping points never move, the blend keeps them
+      double sum = 0.0;
+      for(int i = begin; i < end; i++) {
+        Real x = points.pos_x[i], y = points.pos_y[i], z = points.pos_z[i];
+        if (accelerate) {
+          x = omega * (x - cheb_x[i]) + cheb_x[i];
+          y = omega * (y - cheb_y[i]) + cheb_y[i];
+          z = omega * (z - cheb_z[i]) + cheb_z[i];
+          points.pos_x[i] = x; points.pos_y[i] = y; points.pos_z[i] = z;
+        } else {
+          sum += (double)((x - iter_x[i]) * (x - iter_x[i]) + (y - iter_y[i]) * (y - iter_y[i]) + (z - iter_z[i]) * (z - iter_z[i]));
+        }
+        cheb_x[i] = iter_x[i]; cheb_y[i] = iter_y[i]; cheb_z[i] = iter_z[i];
+        iter_x[i] = x;         iter_y[i] = y;         iter_z[i] = z;
+      }
+      return sum;
+    }, [](double a, double b) { return a + b; });
+    for_lambdas([&](int begin, int end) { // lambda is part of the iterate
+      for(int c = begin; c < end; c++) {
+        Lambda l = lambdas[c];
+        if (accelerate) {
+          l = omega * (l - cheb_lambdas[c]) + cheb_lambdas[c];
+          lambdas[c] = l;
+        }
+        cheb_lambdas[c] = iter_lambdas[c];
+        iter_lambdas[c] = l;
+      }
+    });
+    norm[0] = norm[1];
+    norm[1] = update;
+  }
+  stats.num_iteration   = num_pass;
+  stats.residual        = (float)residual;
+  stats.spectral_radius = (float)rho;
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::LambdaInit(ThreadPool* pool) {
+  ParallelFor(pool, 0, (int)lambdas.size(), 4096, [&](int begin, int end) {
+    std::fill(lambdas.begin() + begin, lambdas.begin() + end, (Lambda)0.0);
+  });
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::Update(Params& params, Float in_dt) {
+  const Real  dt   = (Real)in_dt;
+  ThreadPool* pool = params.thread_pool;
+  BeginSleep(params);
+  if (params.integrator == eIntegrator_Substep) {
+    Real h = dt / (Real)std::max(params.num_substep, 1);
+    Real alpha[eConstraint_Max];
+    BatchAlpha(params, h, alpha);
+    for(int i = 0; i < params.num_substep; i++) {
+      ForAwake(pool, [&](int begin, int end) { points.Integrate(h, begin, end); });
+      if (params.ccd) {
+        SolveCCD(params);
+      }
+      if (i == 0) { // the contacts of the first substep serve the whole step
+        FindContacts(params);
+      }
+      LambdaInit(pool); // reset every substep
+      stats.residual = (float)SolvePass(params, alpha, i);      // one pass per substep, batch intervals count substeps
+      ForAwake(pool, [&](int begin, int end) { points.UpdateVelocity(h, begin, end); });
+    }
+    stats.num_iteration = params.num_substep;
+    EndSleep(params, h, dt);
+  } else {
+    ForAwake(pool, [&](int begin, int end) { points.Predict(dt, begin, end); });
+    if (params.ccd) {
+      SolveCCD(params);
+    }
+    FindContacts(params);
+    LambdaInit(pool); // reset every time frame
+    Real alpha[eConstraint_Max];
+    BatchAlpha(params, dt, alpha);
+    if (params.chebyshev) {
+      SolveChebyshev(params, alpha);
+    } else {
+      Real residual = (Real)0.0;
+      int  num_pass = 0;
+      for(int i = 0; i < params.num_iteration; i++) {
+        residual = SolvePass(params, alpha, i);
+        num_pass = i + 1;
+        if (residual < (Real)params.tolerance) { // settled, num_iteration stays the cap
+          break;
+        }
+      }
+      stats.num_iteration = num_pass;
+      stats.residual      = (float)residual;
+    }
+    EndSleep(params, dt, dt);
+  }
+  normals_dirty = true;
+  bvh_dirty     = true;
+  normal_pool   = pool;
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::BuildFaceAdjacency() {
+  const int num_face = (int)triangles.size() / 3;
+  vert_face_offsets.assign(points.Size() + 1, 0);
+  for(std::uint32_t p : triangles) {
+    vert_face_offsets[p + 1]++;
+  }
+  for(int i = 0; i < points.Size(); i++) {
+    vert_face_offsets[i + 1] += vert_face_offsets[i];
+  }
+  vert_faces.resize(vert_face_offsets.back());
+  std::vector<int> cursor(vert_face_offsets.begin(), vert_face_offsets.end() - 1);
+  for(int f = 0; f < num_face; f++) {
+    for(int k = 0; k < 3; k++) {
+      vert_faces[cursor[triangles[f * 3 + k]]++] = f;
+    }
+  }
+  face_normals.resize(num_face);
+  normals.resize(points.Size());
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::BuildTiles() {
+  const int num_tile = NumTile();
+  for(size_t f = 0; f + 2 < triangles.size(); f += 3) {
+    for(int k = 0; k < 3; k++) {
+      std::uint64_t t0 = (std::uint64_t)(triangles[f + k] / SLEEP_TILE);
+      std::uint64_t t1 = (std::uint64_t)(triangles[f + (k + 1) % 3] / SLEEP_TILE);
+      if (t1 != t0) {
+        tile_links.push_back((t0 << 32) | t1);
+      }
+    }
+  }
+  for(size_t k = 0, num = tile_links.size(); k < num; k++) { // both ways
+    tile_links.push_back((tile_links[k] << 32) | (tile_links[k] >> 32));
+  }
+  std::sort(tile_links.begin(), tile_links.end());
+  tile_links.erase(std::unique(tile_links.begin(), tile_links.end()), tile_links.end());
+  tile_adj_offsets.assign(num_tile + 1, 0);
+  tile_adj.resize(tile_links.size());
+  for(size_t k = 0; k < tile_links.size(); k++) {
+    tile_adj_offsets[(tile_links[k] >> 32) + 1]++;
+    tile_adj[k] = (int)(tile_links[k] & 0xFFFFFFFFu);
+  }
+  for(int t = 0; t < num_tile; t++) {
+    tile_adj_offsets[t + 1] += tile_adj_offsets[t];
+  }
+  tile_links.clear();
+  tile_links.shrink_to_fit();
+  tile_sleep.assign(num_tile, 0);
+  tile_still.assign(num_tile, 0.0f);
+  tile_error.assign(num_tile, (Real)0.0);
+  tile_normals.assign(num_tile, 0);
+  sleep_inv_mass.resize(points.Size());
+  tile_seen.assign(num_tile, 0);
+  tile_frozen.assign(num_tile, 0);
+  awake_tiles.reserve(num_tile);
+  active_tiles.reserve(num_tile);
+  woken_tiles.reserve(num_tile);
+  island_tiles.reserve(num_tile);
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::WakeTile(int tile) {
+  if (tile_sleep[tile] != 0) {
+    int first = tile * SLEEP_TILE, last = std::min(first + SLEEP_TILE, points.Size());
+    std::copy(sleep_inv_mass.begin() + first, sleep_inv_mass.begin() + last, points.inv_mass.begin() + first);
+  }
+  tile_sleep[tile]   = 0;
+  tile_still[tile]   = 0.0f;
+  tile_normals[tile] = 0;
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::BeginSleep(const Params& params) {
+  const int num_tile = (int)tile_sleep.size();
+  sleeping = params.sleep && (num_tile > 0);
+  if (!sleeping) {
+    Wake();
+    return;
+  }
+  awake_tiles.clear();
+  active_tiles.clear();
+  for(int t = 0; t < num_tile; t++) {
+    bool active = (tile_sleep[t] == 0);
+    if (active) {
+      awake_tiles.push_back(t);
+    }
+    for(int k = tile_adj_offsets[t]; (k < tile_adj_offsets[t + 1]) && !active; k++) {
+      active = (tile_sleep[tile_adj[k]] == 0);
+    }
+    if (active) {
+      active_tiles.push_back(t);
+    }
+  }
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::EndSleep(const Params& params, Real h, Real dt) {
+  const int  MIN_GRAIN = 1024;
+  const int  num_tile  = (int)tile_sleep.size();
+  const int  n         = points.Size();
+  const Real still     = (Real)params.sleep_velocity * h;
+  if (!sleeping) {
+    stats.num_sleeping = 0;
+    return;
+  }
+  ParallelFor(params.thread_pool, 0, (int)awake_tiles.size(), MIN_GRAIN / SLEEP_TILE, [&](int begin, int end) {
+    for(int a = begin; a < end; a++) {
+      int  t     = awake_tiles[a];
+      int  first = t * SLEEP_TILE, last = std::min(first + SLEEP_TILE, n);
+      Real max_moved = (Real)0.0;
+      for(int i = first; i < last; i++) {
+        if (points.inv_mass[i] >= FLT_EPSILON) {
+          Real dx = points.pos_x[i] - points.prev_x[i], dy = points.pos_y[i] - points.prev_y[i], dz = points.pos_z[i] - points.prev_z[i];
+          max_moved = std::max(max_moved, dx * dx + dy * dy + dz * dz);
+        }
+      }
+      bool settled = (max_moved < still * still) && ((params.sleep_error <= 0.0f) || (tile_error[t] < (Real)params.sleep_error));
+      bool grabbed = (grab_point >= first) && (grab_point < last);
+      tile_still[t] = (settled && !grabbed) ? tile_still[t] + (float)dt : 0.0f;
+    }
+  });
+  woken_tiles.clear(); // waking spreads a tile per step
+  for(int t = 0; t < num_tile; t++) {
+    for(int k = tile_adj_offsets[t]; (k < tile_adj_offsets[t + 1]) && (tile_sleep[t] != 0); k++) {
+      if ((tile_sleep[tile_adj[k]] == 0) && (tile_still[tile_adj[k]] <= 0.0f)) {
+        woken_tiles.push_back(t);
+        break;
+      }
+    }
+  }
+  for(int t : woken_tiles) {
+    WakeTile(t);
+  }
+  // islands of awake tiles sleep as a whole, a sleeper next to an awake tile would shift its balance and wake again
+  std::fill(tile_seen.begin(), tile_seen.end(), 0);
+  for(int t = 0; t < num_tile; t++) {
+    if ((tile_sleep[t] != 0) || (tile_seen[t] != 0)) {
+      continue;
+    }
+    bool settled = true;
+    island_tiles.assign(1, t);
+    tile_seen[t] = 1;
+    for(size_t q = 0; q < island_tiles.size(); q++) {
+      int u   = island_tiles[q];
+      settled = settled && (tile_still[u] >= SLEEP_TIME);
+      for(int k = tile_adj_offsets[u]; k < tile_adj_offsets[u + 1]; k++) {
+        int v = tile_adj[k];
+        if ((tile_sleep[v] == 0) && (tile_seen[v] == 0)) {
+          tile_seen[v] = 1;
+          island_tiles.push_back(v);
+        }
+      }
+    }
+    if (!settled) {
+      continue;
+    }
+    for(int u : island_tiles) { // at rest where it stopped, immovable to the constraints of whatever wakes next to it
+      int first = u * SLEEP_TILE, last = std::min(first + SLEEP_TILE, n);
+      std::copy(points.pos_x.begin() + first, points.pos_x.begin() + last, points.prev_x.begin() + first);
+      std::copy(points.pos_y.begin() + first, points.pos_y.begin() + last, points.prev_y.begin() + first);
+      std::copy(points.pos_z.begin() + first, points.pos_z.begin() + last, points.prev_z.begin() + first);
+      std::fill(points.vel_x.begin() + first, points.vel_x.begin() + last, (Real)0.0);
+      std::fill(points.vel_y.begin() + first, points.vel_y.begin() + last, (Real)0.0);
+      std::fill(points.vel_z.begin() + first, points.vel_z.begin() + last, (Real)0.0);
+      std::copy(points.inv_mass.begin() + first, points.inv_mass.begin() + last, sleep_inv_mass.begin() + first);
+      std::fill(points.inv_mass.begin() + first, points.inv_mass.begin() + last, (Real)0.0);
+      tile_sleep[u] = 1;
+    }
+  }
+  int num_sleeping = 0;
+  for(int t = 0; t < num_tile; t++) {
+    if (tile_sleep[t] != 0) {
+      num_sleeping += std::min(t * SLEEP_TILE + SLEEP_TILE, n) - t * SLEEP_TILE;
+    }
+  }
+  stats.num_sleeping = num_sleeping;
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::CalcNormal(ThreadPool* pool) const {
+  const int MIN_GRAIN = 1024;
+  const int num_tile  = (int)tile_normals.size();
+  for(int t = 0; t < num_tile; t++) {
+    tile_frozen[t] = tile_normals[t];
+    for(int k = tile_adj_offsets[t]; (k < tile_adj_offsets[t + 1]) && tile_frozen[t]; k++) {
+      tile_frozen[t] = tile_normals[tile_adj[k]];
+    }
+  }
+  ParallelFor(pool, 0, (int)face_normals.size(), MIN_GRAIN, [&](int begin, int end) {
+    for(int f = begin; f < end; f++) {
+      if ((num_tile > 0) && tile_frozen[triangles[f * 3] / SLEEP_TILE]) {
+        continue;
+      }
+      Vec3 v0 = points.Position(triangles[f * 3 + 0]);
+      Vec3 v1 = points.Position(triangles[f * 3 + 1]);
+      Vec3 v2 = points.Position(triangles[f * 3 + 2]);
+      face_normals[f] = glm::normalize(glm::cross(v2 - v0, v1 - v0));
+    }
+  });
+  ParallelFor(pool, 0, points.Size(), MIN_GRAIN, [&](int begin, int end) {
+    for(int i = begin; i < end; i++) {
+      if ((num_tile > 0) && tile_frozen[i / SLEEP_TILE]) {
+        continue;
+      }
+      Vec3 n((Real)0.0);
+      for(int k = vert_face_offsets[i]; k < vert_face_offsets[i + 1]; k++) {
+        n += face_normals[vert_faces[k]];
+      }
+      normals[i] = glm::normalize(n);
+    }
+  });
+  std::copy(tile_sleep.begin(), tile_sleep.end(), tile_normals.begin());
+  normals_dirty = false;
+}
+
+template<typename Real, typename Lambda>
+bool SceneSolver<Real, Lambda>::Pick(const glm::vec3& origin, const glm::vec3& dir, float& t, int& point) const {
+  typename TriangleBVH<Real>::Hit hit;
+  if (!GetBVH().Raycast(points, triangles, Vec3(origin), Vec3(dir), std::numeric_limits<Real>::max(), hit)) {
+    return false;
+  }
+  int corner = (hit.bary.x >= hit.bary.y) ? ((hit.bary.x >= hit.bary.z) ? 0 : 2) : ((hit.bary.y >= hit.bary.z) ? 1 : 2);
+  t     = (float)hit.t;
+  point = (int)triangles[hit.tri * 3 + corner];
+  return true;
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::Grab(int point, const glm::vec3& pos) {
+  if (!tile_sleep.empty()) {
+    WakeTile(point / SLEEP_TILE);
+  }
+  if (point != grab_point) {
+    Release();
+    grab_point    = point;
+    grab_inv_mass = points.inv_mass[point];
+    points.inv_mass[point] = (Real)0.0;
+  }
+  points.pos_x[point] = points.prev_x[point] = (Real)pos.x;
+  points.pos_y[point] = points.prev_y[point] = (Real)pos.y;
+  points.pos_z[point] = points.prev_z[point] = (Real)pos.z;
+  points.vel_x[point] = points.vel_y[point] = points.vel_z[point] = (Real)0.0;
+  normals_dirty = true;
+  bvh_dirty     = true;
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::Wake() {
+  for(int t = 0; t < (int)tile_sleep.size(); t++) {
+    WakeTile(t);
+  }
+}
+
+template<typename Real, typename Lambda>
+void SceneSolver<Real, Lambda>::Release() {
+  if (grab_point >= 0) {
+    points.inv_mass[grab_point] = grab_inv_mass;
+    grab_point = -1;
+  }
+}
+
+template class SceneSolver<float>;
+template class SceneSolver<double>;
+template class SceneSolver<float, double>;
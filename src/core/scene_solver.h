@@ -0,0 +1,347 @@
+#pragma once
+
+#include "core/scene.h"
+#include "core/constraint.h"
+#include "core/thread_pool.h"
+#include "core/bvh.h"
+#include <type_traits>
+
+// one constraint type, constraints [begin, end) of the scene
+struct ConstraintBatch {
+  int                             begin;
+  int                             end;
+  int                             lambda;        // constraint c has the NUM_LAMBDA lambdas from lambdas[lambda + (c - begin) * NUM_LAMBDA]
+  int                             num_lambda;    // NUM_LAMBDA of the constraint type, set by ColorConstraints
+  std::vector<int>                color_offsets; // constraints[color_offsets[k], color_offsets[k+1]) share no particle, the rest up to end is uncolored
+  std::vector<int>                tile_offsets;  // sleep : color k of tile t is [tile_offsets[k * (num_tile + 1) + t], tile_offsets[k * (num_tile + 1) + t + 1])
+  ConstraintBatch() : begin(0), end(0), lambda(0), num_lambda(1), color_offsets(), tile_offsets() {}
+};
+
+// vector kernel of every constraint type, see SolveDistanceSimd
+template<typename Real, typename Lambda>
+inline int SolveSimd(const DistanceConstraint<Real>* c, Lambda* lambda, int count, Points<Real>& points, Real alpha, Real& residual) {
+  return SolveDistanceSimd(c, lambda, count, points, alpha, residual);
+}
+template<typename Real, typename Lambda>
+inline int SolveSimd(const DihedralConstraint<Real>* c, Lambda* lambda, int count, Points<Real>& points, Real alpha, Real& residual) {
+  return SolveDihedralSimd(c, lambda, count, points, alpha, residual);
+}
+template<typename Real, typename Lambda>
+inline int SolveSimd(const VolumeConstraint<Real>* c, Lambda* lambda, int count, Points<Real>& points, Real alpha, Real& residual) {
+  return SolveVolumeSimd(c, lambda, count, points, alpha, residual);
+}
+template<typename Real, bool Hydrostatic, typename Lambda>
+inline int SolveSimd(const NeoHookeanConstraint<Real, Hydrostatic>* c, Lambda* lambda, int count, Points<Real>& points, Real alpha, Real& residual) {
+  return SolveNeoHookeanSimd(c, lambda, count, points, alpha, residual);
+}
+
+// the time step every scene shares : prediction or substeps, lambda reset, solver passes with chebyshev and
+// tolerance, lazy normals and BVH of a triangle surface, and grabbing. a scene fills points, triangles and its constraint
+// batches, then implements one solver pass.
+// sleep works on tiles of SLEEP_TILE consecutive points, compact patches thanks to the morton order. an island of awake
+// tiles, linked by constraints or triangles, falls asleep as a whole once all of it stayed slow for SLEEP_TIME : its
+// points keep their inverse mass aside and take 0, and skip prediction, colliders, constraint ranges and normals.
+// a sleeper wakes once a linked tile moves, on Grab or Wake, so waking spreads a tile per step. the constraints between
+// sleepers and awake tiles are still solved, the awake side leans on the sleepers as on pinned points.
+// a scene that never calls BuildTiles never sleeps
+// Real : positions and everything derived from them, Lambda : accumulated lagrange multipliers
+template<typename Real, typename Lambda = Real>
+class SceneSolver : public Scene {
+public:
+  typedef glm::vec<3, Real> Vec3;
+protected:
+  Points<Real>                          points;
+  mutable std::vector<Vec3>             normals;
+  mutable std::vector<Vec3>             face_normals;
+  std::vector<int>                      vert_face_offsets;      // faces around point i are vert_faces[vert_face_offsets[i], vert_face_offsets[i+1])
+  std::vector<int>                      vert_faces;
+  mutable bool                          normals_dirty;          // normals are computed on demand, headless runs never pay for them
+  ThreadPool*                           normal_pool;            // pool of the last Update, used by the lazy normal pass
+  mutable TriangleBVH<Real>             bvh;                    // over triangles, refit on demand like the normals
+  mutable bool                          bvh_dirty;
+  int                                   grab_point;             // -1 : none
+  Real                                  grab_inv_mass;          // of grab_point before Grab
+  static const int SLEEP_TILE = 256;                            // points per sleep tile
+  std::vector<int>                      tile_adj_offsets;       // tiles sharing a constraint or triangle with tile t are tile_adj[tile_adj_offsets[t], tile_adj_offsets[t+1])
+  std::vector<int>                      tile_adj;
+  std::vector<std::uint64_t>            tile_links;             // tile pairs gathered by TileConstraints until BuildTiles
+  std::vector<std::uint8_t>             tile_sleep;             // 1 : asleep
+  std::vector<float>                    tile_still;             // seconds below the thresholds
+  std::vector<Real>                     tile_error;             // largest |C + a~ lambda| of the last pass
+  AlignedVector<Real>                   sleep_inv_mass;         // inverse mass of sleeping points, theirs is 0 until they wake
+  mutable std::vector<std::uint8_t>     tile_normals;           // 1 : asleep since the last CalcNormal, its points have not moved
+  std::vector<int>                      awake_tiles;
+  std::vector<int>                      active_tiles;           // awake or linked to an awake tile
+  std::vector<int>                      woken_tiles;            // EndSleep : sleepers linked to a moving tile
+  std::vector<int>                      island_tiles;           // EndSleep : the island being gathered
+  std::vector<std::uint8_t>             tile_seen;              // EndSleep : 1 once in an island
+  mutable std::vector<std::uint8_t>     tile_frozen;            // CalcNormal : the tile and all its links unmoved, so are its faces and normals
+  bool                                  sleeping;               // Params::sleep on a scene with tiles, this step
+  std::vector<Lambda>                   lambdas;                // every batch back to back
+  ConstraintBatch                       batches[eConstraint_Max];
+  AlignedVector<Real>                   cheb_x, cheb_y, cheb_z; // chebyshev : positions of iteration k-1
+  AlignedVector<Real>                   iter_x, iter_y, iter_z; // chebyshev : positions of iteration k
+  AlignedVector<Lambda>                 cheb_lambdas, iter_lambdas;
+  std::vector<int>                      cheb_ranges;            // chebyshev, sleep : [begin, end) pairs of the lambdas the passes solve
+  std::vector<std::uint32_t>            triangles;
+  std::vector<int>                      remap;                  // point in construction order -> index into points
+  // sort points along a morton curve and remap triangles. the scene then calls RemapConstraints on every constraint array
+  void   ReorderPoints();
+  // apply remap to data[0, num) and sort it by first point, so a color range walks memory forward
+  template<typename Constraint>
+  void   RemapConstraints(Constraint* data, int num) const;
+  // greedy graph coloring, then sort the batch by color so every color is a contiguous independent range.
+  // data is the constraint at batch.begin
+  template<typename Constraint>
+  void   ColorConstraints(ConstraintBatch& batch, Constraint* data);
+  // sleep : tile ranges of every color, each sorted by lowest point after ColorConstraints, and the tiles data links
+  template<typename Constraint>
+  void   TileConstraints(ConstraintBatch& batch, const Constraint* data);
+  // sleep : tile adjacency of the linked pairs and the triangles, every tile awake
+  void   BuildTiles();
+  // f(begin, end) over the colors of a batch in turn, each color in parallel, only the ranges of active tiles while
+  // sleeping. f returns the largest |C + a~ lambda| of its range, kept per tile. the uncolored rest is left to the caller
+  template<typename F>
+  Real   SolveColors(ThreadPool* pool, const ConstraintBatch& batch, F&& f);
+  // f(begin, end) over the points of the awake tiles, all of them without sleep, combined like ParallelReduce
+  template<typename T, typename F, typename C>
+  T      ReduceAwake(ThreadPool* pool, T init, F&& f, C&& combine) const;
+  template<typename F>
+  void   ForAwake(ThreadPool* pool, F&& f) const {
+    const int MIN_GRAIN = 1024;
+    if (!sleeping) {
+      ParallelFor(pool, 0, points.Size(), MIN_GRAIN, f);
+      return;
+    }
+    ReduceAwake(pool, 0, [&](int begin, int end) { f(begin, end); return 0; }, [](int a, int) { return a; });
+  }
+  // awake and active tiles of the step, everything wakes once Params::sleep is off
+  void   BeginSleep(const Params& params);
+  // still time of the awake tiles, sleepers linked to a moving tile wake, then settled islands fall asleep.
+  // h : step of pos - prev, dt : the whole step
+  void   EndSleep(const Params& params, Real h, Real dt);
+  void   WakeTile(int tile);
+  // one gauss-seidel pass over the colors of a batch, each color in parallel. returns the largest |C + a~ lambda|
+  template<typename Constraint>
+  Real   SolveBatch(ThreadPool* pool, const ConstraintBatch& batch, const Constraint* data, Real alpha);
+  // a~ of every batch for time step h
+  void   BatchAlpha(const Params& params, Real h, Real* alpha) const;
+  // solver passes skip batches that BatchParams::Solve(pass) excludes,
+  // and return the largest |C + a~ lambda| seen before each projection
+  virtual Real SolveIteration(Params& params, const Real* alpha, int pass) = 0;
+  // Params::ccd : stops the predicted motion prev -> pos before it tunnels through a collider, ahead of FindContacts
+  virtual void SolveCCD(Params& params);
+  // contacts between points of the scene, found once per step after the prediction and projected on every pass
+  virtual void FindContacts(Params&) {}
+  virtual Real SolveContacts(Params&) { return (Real)0.0; }
+  // SolveIteration, SolveContacts, then every point is pushed out of Params::colliders. penetrations count as residual
+  Real   SolvePass(Params& params, const Real* alpha, int pass);
+  // Wang 2015, A Chebyshev Semi-Iterative Approach for Accelerating Projective and Position-based Dynamics
+  void   SolveChebyshev(Params& params, const Real* alpha);
+  void   LambdaInit(ThreadPool* pool);
+  void   BuildFaceAdjacency();
+  SceneSolver();
+  ~SceneSolver();
+public:
+  virtual void Update(Params& params, Float dt);
+  // face normals, then every point gathers its own faces, no scatter so both passes run in parallel
+  void   CalcNormal(ThreadPool* pool) const;
+  int    NumConstraints() const {
+    int num = 0;
+    for(const auto& batch : batches) {
+      num += batch.end - batch.begin;
+    }
+    return num;
+  }
+  int    NumLambdas()     const { return (int)lambdas.size(); }
+  int    NumTile()        const { return (points.Size() + SLEEP_TILE - 1) / SLEEP_TILE; }
+  const ConstraintBatch&                       GetBatch(int type) const { return batches[type]; }
+  // render data, triangles index GetPoints() and GetNormals()
+  const Points<Real>&                          GetPoints()        const { return points; }
+  const std::vector<std::uint32_t>&            GetTriangles()     const { return triangles; }
+  const std::vector<int>&                      GetRemap()         const { return remap; }
+  const std::vector<Vec3>&                     GetNormals()       const {
+    if (normals_dirty) {
+      CalcNormal(normal_pool);
+    }
+    return normals;
+  }
+  const TriangleBVH<Real>&                     GetBVH()           const {
+    if (bvh_dirty) {
+      bvh.Refit(normal_pool, points, triangles);
+      bvh_dirty = false;
+    }
+    return bvh;
+  }
+  virtual void FillVertexBuffer(std::vector<float>& out) const { ::FillVertexBuffer(points, triangles, GetNormals(), out); }
+  virtual bool Pick(const glm::vec3& origin, const glm::vec3& dir, float& t, int& point) const;
+  virtual void Grab(int point, const glm::vec3& pos);
+  virtual void Release();
+  virtual void Wake();
+};
+
+template<typename Real, typename Lambda>
+template<typename Constraint>
+void SceneSolver<Real, Lambda>::RemapConstraints(Constraint* data, int num) const {
+  auto first = [](const Constraint& c) {
+    std::uint32_t p = c.Point(0);
+    for(int k = 1; k < Constraint::NUM_POINT; k++) {
+      p = std::min(p, c.Point(k));
+    }
+    return p;
+  };
+  for(int c = 0; c < num; c++) {
+    for(int k = 0; k < Constraint::NUM_POINT; k++) {
+      data[c].Point(k) = (std::uint32_t)remap[data[c].Point(k)];
+    }
+  }
+  std::stable_sort(data, data + num, [&](const Constraint& a, const Constraint& b) { return first(a) < first(b); });
+}
+
+template<typename Real, typename Lambda>
+template<typename Constraint>
+void SceneSolver<Real, Lambda>::ColorConstraints(ConstraintBatch& batch, Constraint* data) {
+  static const int MAX_COLOR = 64;
+  const int                  num = batch.end - batch.begin;
+  std::vector<std::uint64_t> used(points.Size(), 0);
+  std::vector<int>           colors(num, MAX_COLOR); // MAX_COLOR : left over, solved serially
+  int                        num_colors = 0;
+  for(int c = 0; c < num; c++) {
+    std::uint64_t mask = 0;
+    for(int p = 0; p < Constraint::NUM_POINT; p++) {
+      mask |= used[data[c].Point(p)];
+    }
+    for(int k = 0; k < MAX_COLOR; k++) {
+      if ((mask & ((std::uint64_t)1 << k)) == 0) {
+        colors[c] = k;
+        for(int p = 0; p < Constraint::NUM_POINT; p++) {
+          used[data[c].Point(p)] |= (std::uint64_t)1 << k;
+        }
+        num_colors = std::max(num_colors, k + 1);
+        break;
+      }
+    }
+  }
+  std::vector<int> count(MAX_COLOR + 1, 0);
+  for(int k : colors) {
+    count[k]++;
+  }
+  batch.num_lambda = Constraint::NUM_LAMBDA;
+  batch.color_offsets.assign(1, batch.begin);
+  for(int k = 0; k < num_colors; k++) {
+    batch.color_offsets.push_back(batch.color_offsets.back() + count[k]);
+  }
+  std::vector<int> order(num);
+  for(int c = 0; c < num; c++) {
+    order[c] = c;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return colors[a] < colors[b]; });
+  std::vector<Constraint> sorted;
+  sorted.reserve(num);
+  for(int c : order) {
+    sorted.push_back(data[c]);
+  }
+  std::copy(sorted.begin(), sorted.end(), data);
+}
+
+template<typename Real, typename Lambda>
+template<typename Constraint>
+void SceneSolver<Real, Lambda>::TileConstraints(ConstraintBatch& batch, const Constraint* data) {
+  const int num_tile = NumTile();
+  auto tile = [](const Constraint& c) {
+    std::uint32_t p = c.Point(0);
+    for(int k = 1; k < Constraint::NUM_POINT; k++) {
+      p = std::min(p, c.Point(k));
+    }
+    return (int)p / SLEEP_TILE;
+  };
+  batch.tile_offsets.clear();
+  for(size_t k = 0; k + 1 < batch.color_offsets.size(); k++) {
+    int c = batch.color_offsets[k];
+    for(int t = 0; t <= num_tile; t++) {
+      while ((c < batch.color_offsets[k + 1]) && (tile(data[c - batch.begin]) < t)) {
+        c++;
+      }
+      batch.tile_offsets.push_back(c);
+    }
+  }
+  for(int c = 0; c < batch.end - batch.begin; c++) {
+    std::uint64_t t0 = (std::uint64_t)(data[c].Point(0) / SLEEP_TILE);
+    for(int k = 1; k < Constraint::NUM_POINT; k++) {
+      std::uint64_t t1 = (std::uint64_t)(data[c].Point(k) / SLEEP_TILE);
+      if (t1 != t0) {
+        tile_links.push_back((t0 << 32) | t1);
+      }
+    }
+  }
+}
+
+template<typename Real, typename Lambda>
+template<typename F>
+Real SceneSolver<Real, Lambda>::SolveColors(ThreadPool* pool, const ConstraintBatch& batch, F&& f) {
+  const int MIN_GRAIN  = 256;
+  const int TILE_GRAIN = 4;                      // a color holds a few dozen constraints of a tile
+  const int stride     = NumTile() + 1;
+  auto      max        = [](Real a, Real b) { return std::max(a, b); };
+  Real      residual   = (Real)0.0;
+  for(size_t k = 0; k + 1 < batch.color_offsets.size(); k++) {
+    if (!sleeping || batch.tile_offsets.empty()) {
+      residual = std::max(residual, ParallelReduce(pool, batch.color_offsets[k], batch.color_offsets[k + 1], MIN_GRAIN, (Real)0.0, f, max));
+      continue;
+    }
+    const int* offsets = &batch.tile_offsets[k * stride];
+    residual = std::max(residual, ParallelReduce(pool, 0, (int)active_tiles.size(), TILE_GRAIN, (Real)0.0, [&](int begin, int end) {
+      Real max_residual = (Real)0.0;
+      for(int a = begin; a < end; a++) {
+        int t = active_tiles[a];
+        if (offsets[t] < offsets[t + 1]) {
+          Real r = f(offsets[t], offsets[t + 1]);
+          tile_error[t] = std::max(tile_error[t], r);
+          max_residual  = std::max(max_residual, r);
+        }
+      }
+      return max_residual;
+    }, max));
+  }
+  return residual;
+}
+
+template<typename Real, typename Lambda>
+template<typename T, typename F, typename C>
+T SceneSolver<Real, Lambda>::ReduceAwake(ThreadPool* pool, T init, F&& f, C&& combine) const {
+  const int MIN_GRAIN = 1024;
+  const int n         = points.Size();
+  if (!sleeping) {
+    return ParallelReduce(pool, 0, n, MIN_GRAIN, init, f, combine);
+  }
+  return ParallelReduce(pool, 0, (int)awake_tiles.size(), MIN_GRAIN / SLEEP_TILE, init, [&](int begin, int end) {
+    T value = init;
+    for(int a = begin; a < end; a++) {
+      int t = awake_tiles[a];
+      value = combine(value, f(t * SLEEP_TILE, std::min((t + 1) * SLEEP_TILE, n)));
+    }
+    return value;
+  }, combine);
+}
+
+template<typename Real, typename Lambda>
+template<typename Constraint>
+Real SceneSolver<Real, Lambda>::SolveBatch(ThreadPool* pool, const ConstraintBatch& batch, const Constraint* data, Real alpha) {
+  Real residual = (Real)0.0;
+  if (batch.color_offsets.empty()) { // a batch the scene does not use
+    return residual;
+  }
+  auto lambda = [&](int c) { return &lambdas[batch.lambda + (c - batch.begin) * Constraint::NUM_LAMBDA]; };
+  residual = SolveColors(pool, batch, [&](int begin, int end) {
+    Real max_residual = (Real)0.0;
+    begin += SolveSimd(&data[begin - batch.begin], lambda(begin), end - begin, points, alpha, max_residual);
+    for(int c = begin; c < end; c++) {
+      max_residual = std::max(max_residual, data[c - batch.begin].SolvePosition(points, lambda(c), alpha));
+    }
+    return max_residual;
+  });
+  for(int c = batch.color_offsets.back(); c < batch.end; c++) { // uncolored, solved whole even while sleeping
+    residual = std::max(residual, data[c - batch.begin].SolvePosition(points, lambda(c), alpha));
+  }
+  return residual;
+}
@@ -0,0 +1,628 @@
+#include "core/self_collision.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+  // barycentric coordinates of x projected onto the plane of a b c, false for a degenerate triangle
+  template<typename Real>
+  bool barycentric(const glm::vec<3, Real>& x, const glm::vec<3, Real>& a, const glm::vec<3, Real>& b, const glm::vec<3, Real>& c, glm::vec<3, Real>& bary) {
+    glm::vec<3, Real> e0 = b - a, e1 = c - a, d = x - a;
+    Real d00 = glm::dot(e0, e0), d01 = glm::dot(e0, e1), d11 = glm::dot(e1, e1);
+    Real d20 = glm::dot(d, e0),  d21 = glm::dot(d, e1);
+    Real den = d00 * d11 - d01 * d01;
+    if (den <= (Real)FLT_EPSILON * d00 * d11) {
+      return false;
+    }
+    bary.y = (d11 * d20 - d01 * d21) / den;
+    bary.z = (d00 * d21 - d01 * d20) / den;
+    bary.x = (Real)1.0 - bary.y - bary.z;
+    return true;
+  }
+
+  // times in [0, 1] where four points moving linearly from x0 to x1 are coplanar, ascending. the triple product is a
+  // cubic in t, bracketed between the roots of its derivative and bisected. none when it vanishes throughout, as for a
+  // flat sheet moving in its own plane
+  template<typename Real>
+  int CoplanarTimes(const glm::vec<3, Real>* x0, const glm::vec<3, Real>* x1, Real* t) {
+    typedef glm::vec<3, Real> Vec3;
+    const int BISECT = 32;
+    Vec3 a0 = x0[1] - x0[0], b0 = x0[2] - x0[0], c0 = x0[3] - x0[0];
+    Vec3 a1 = x1[1] - x1[0] - a0, b1 = x1[2] - x1[0] - b0, c1 = x1[3] - x1[0] - c0;
+    Vec3 n0 = glm::cross(a0, b0), n1 = glm::cross(a0, b1) + glm::cross(a1, b0), n2 = glm::cross(a1, b1);
+    Real k[4] = { glm::dot(n0, c0), glm::dot(n1, c0) + glm::dot(n0, c1), glm::dot(n2, c0) + glm::dot(n1, c1), glm::dot(n2, c1) };
+    Real scale = std::max(std::max(glm::length(a0), glm::length(b0)), std::max(glm::length(c0), std::max(glm::length(a0 + a1), std::max(glm::length(b0 + b1), glm::length(c0 + c1)))));
+    if (std::max(std::max(std::abs(k[0]), std::abs(k[1])), std::max(std::abs(k[2]), std::abs(k[3]))) <= (Real)FLT_EPSILON * scale * scale * scale) {
+      return 0;
+    }
+    Real bern[4] = { k[0], k[0] + k[1] / (Real)3.0, k[0] + (k[1] * (Real)2.0 + k[2]) / (Real)3.0, k[0] + k[1] + k[2] + k[3] };
+    if (((bern[0] > (Real)0.0) && (bern[1] > (Real)0.0) && (bern[2] > (Real)0.0) && (bern[3] > (Real)0.0)) ||
+        ((bern[0] < (Real)0.0) && (bern[1] < (Real)0.0) && (bern[2] < (Real)0.0) && (bern[3] < (Real)0.0))) {
+      return 0; // bernstein coefficients of one sign, the common case of a pair that stays apart
+    }
+    auto f     = [&](Real x) { return ((k[3] * x + k[2]) * x + k[1]) * x + k[0]; };
+    Real split[4];
+    int  num_split = 0;
+    split[num_split++] = (Real)0.0;
+    Real qa = (Real)3.0 * k[3], qb = (Real)2.0 * k[2], qc = k[1]; // f'
+    Real ext[2];
+    int  num_ext = 0;
+    if (std::abs(qa) > (Real)FLT_EPSILON * std::abs(qb)) {
+      Real disc = qb * qb - (Real)4.0 * qa * qc;
+      if (disc >= (Real)0.0) {
+        Real r = std::sqrt(disc);
+        ext[num_ext++] = (-qb - r) / ((Real)2.0 * qa);
+        ext[num_ext++] = (-qb + r) / ((Real)2.0 * qa);
+      }
+    } else if (qb != (Real)0.0) {
+      ext[num_ext++] = -qc / qb;
+    }
+    if ((num_ext == 2) && (ext[1] < ext[0])) {
+      std::swap(ext[0], ext[1]);
+    }
+    for(int e = 0; e < num_ext; e++) {
+      if ((ext[e] > (Real)0.0) && (ext[e] < (Real)1.0)) {
+        split[num_split++] = ext[e];
+      }
+    }
+    split[num_split++] = (Real)1.0;
+    int num = 0;
+    for(int s = 0; s + 1 < num_split; s++) {
+      Real lo = split[s], hi = split[s + 1], flo = f(lo), fhi = f(hi);
+      if (flo == (Real)0.0) {
+        if ((num == 0) || (t[num - 1] < lo)) {
+          t[num++] = lo;
+        }
+        continue;
+      }
+      if (flo * fhi > (Real)0.0) {
+        continue;
+      }
+      for(int i = 0; i < BISECT; i++) {
+        Real mid = (lo + hi) * (Real)0.5, fmid = f(mid);
+        if ((fmid == (Real)0.0) || ((flo < (Real)0.0) != (fmid < (Real)0.0))) {
+          hi = mid;
+        } else {
+          lo  = mid;
+          flo = fmid;
+        }
+      }
+      t[num++] = hi;
+    }
+    return num;
+  }
+
+  // closest points of segments p0 p1 and q0 q1, returns the squared distance (Ericson 2005, 5.1.9)
+  template<typename Real>
+  Real SegmentDistance2(const glm::vec<3, Real>& p0, const glm::vec<3, Real>& p1, const glm::vec<3, Real>& q0, const glm::vec<3, Real>& q1) {
+    glm::vec<3, Real> d1 = p1 - p0, d2 = q1 - q0, r = p0 - q0;
+    Real a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+    Real s = (Real)0.0, u = (Real)0.0;
+    if ((a <= (Real)FLT_EPSILON) && (e <= (Real)FLT_EPSILON)) {
+      return glm::dot(r, r);
+    }
+    if (a <= (Real)FLT_EPSILON) {
+      u = glm::clamp(f / e, (Real)0.0, (Real)1.0);
+    } else {
+      Real c = glm::dot(d1, r);
+      if (e <= (Real)FLT_EPSILON) {
+        s = glm::clamp(-c / a, (Real)0.0, (Real)1.0);
+      } else {
+        Real b     = glm::dot(d1, d2);
+        Real denom = a * e - b * b;
+        s = (denom > (Real)0.0) ? glm::clamp((b * f - c * e) / denom, (Real)0.0, (Real)1.0) : (Real)0.0;
+        u = (b * s + f) / e;
+        if (u < (Real)0.0) {
+          u = (Real)0.0;
+          s = glm::clamp(-c / a, (Real)0.0, (Real)1.0);
+        } else if (u > (Real)1.0) {
+          u = (Real)1.0;
+          s = glm::clamp((b - c) / a, (Real)0.0, (Real)1.0);
+        }
+      }
+    }
+    glm::vec<3, Real> diff = (p0 + d1 * s) - (q0 + d2 * u);
+    return glm::dot(diff, diff);
+  }
+
+  // squared distance of p to triangle a b c (Ericson 2005, 5.1.5)
+  template<typename Real>
+  Real TriangleDistance2(const glm::vec<3, Real>& p, const glm::vec<3, Real>& a, const glm::vec<3, Real>& b, const glm::vec<3, Real>& c) {
+    glm::vec<3, Real> ab = b - a, ac = c - a, ap = p - a, q;
+    Real d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    glm::vec<3, Real> bp = p - b, cp = p - c;
+    Real d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp), d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    Real va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+    if ((d1 <= (Real)0.0) && (d2 <= (Real)0.0)) {
+      q = a;
+    } else if ((d3 >= (Real)0.0) && (d4 <= d3)) {
+      q = b;
+    } else if ((d6 >= (Real)0.0) && (d5 <= d6)) {
+      q = c;
+    } else if ((vc <= (Real)0.0) && (d1 >= (Real)0.0) && (d3 <= (Real)0.0)) {
+      q = a + ab * (d1 / (d1 - d3));
+    } else if ((vb <= (Real)0.0) && (d2 >= (Real)0.0) && (d6 <= (Real)0.0)) {
+      q = a + ac * (d2 / (d2 - d6));
+    } else if ((va <= (Real)0.0) && ((d4 - d3) >= (Real)0.0) && ((d5 - d6) >= (Real)0.0)) {
+      q = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    } else {
+      Real den = (Real)1.0 / (va + vb + vc);
+      q = a + ab * (vb * den) + ac * (vc * den);
+    }
+    return glm::dot(p - q, p - q);
+  }
+
+  // earliest impact of point x[0] against triangle x[1] x[2] x[3] (face) or of edge x[0] x[1] against x[2] x[3],
+  // closer than eta at a coplanar time
+  template<typename Real>
+  bool FirstImpact(const glm::vec<3, Real>* x0, const glm::vec<3, Real>* x1, bool face, Real eta, Real& toi) {
+    const Real BARY_TOL = (Real)1e-3;
+    Real reach = (Real)0.0; // bound of the relative motion of any two points of the pair
+    for(int i = 0; i < (face ? 1 : 2); i++) {
+      for(int j = (face ? 1 : 2); j < 4; j++) {
+        reach = std::max(reach, glm::length((x1[i] - x0[i]) - (x1[j] - x0[j])));
+      }
+    }
+    Real dist2 = face ? TriangleDistance2(x0[0], x0[1], x0[2], x0[3]) : SegmentDistance2(x0[0], x0[1], x0[2], x0[3]);
+    if (dist2 > (reach + eta) * (reach + eta)) { // too far apart at 0 to meet within the step
+      return false;
+    }
+    Real t[3];
+    int  num = CoplanarTimes(x0, x1, t);
+    for(int k = 0; k < num; k++) {
+      glm::vec<3, Real> x[4];
+      for(int c = 0; c < 4; c++) {
+        x[c] = x0[c] + (x1[c] - x0[c]) * t[k];
+      }
+      if (face) {
+        glm::vec<3, Real> bary;
+        glm::vec<3, Real> n = glm::cross(x[2] - x[1], x[3] - x[1]);
+        Real              len = glm::length(n);
+        if ((len > (Real)FLT_EPSILON) && (std::abs(glm::dot(x[0] - x[1], n)) < eta * len) && barycentric(x[0], x[1], x[2], x[3], bary) &&
+            (glm::min(bary.x, glm::min(bary.y, bary.z)) >= -BARY_TOL)) {
+          toi = t[k];
+          return true;
+        }
+      } else if (SegmentDistance2(x[0], x[1], x[2], x[3]) < eta * eta) {
+        toi = t[k];
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // f(begin, end) in parallel over the points of tiles, tile_size consecutive points each, over all num points
+  // without tiles
+  template<typename F>
+  void for_tiles(ThreadPool* pool, int num, const std::vector<int>* tiles, int tile_size, int min_grain, F&& f) {
+    if (tiles == nullptr) {
+      ParallelFor(pool, 0, num, min_grain, f);
+      return;
+    }
+    ParallelFor(pool, 0, (int)tiles->size(), std::max(min_grain / tile_size, 1), [&](int begin, int end) {
+      for(int a = begin; a < end; a++) {
+        int t = (*tiles)[a];
+        f(t * tile_size, std::min((t + 1) * tile_size, num));
+      }
+    });
+  }
+
+  // for_tiles combined like ParallelReduce
+  template<typename T, typename F, typename C>
+  T reduce_tiles(ThreadPool* pool, int num, const std::vector<int>* tiles, int tile_size, int min_grain, T init, F&& f, C&& combine) {
+    if (tiles == nullptr) {
+      return ParallelReduce(pool, 0, num, min_grain, init, f, combine);
+    }
+    return ParallelReduce(pool, 0, (int)tiles->size(), std::max(min_grain / tile_size, 1), init, [&](int begin, int end) {
+      T value = init;
+      for(int a = begin; a < end; a++) {
+        int t = (*tiles)[a];
+        value = combine(value, f(t * tile_size, std::min((t + 1) * tile_size, num)));
+      }
+      return value;
+    }, combine);
+  }
+};
+
+template<typename Real>
+SelfCollision<Real>::SelfCollision() : thickness((Real)0.0), radius((Real)0.0), rest_x(), rest_y(), rest_z(), hash(), pairs(), tris(), pair_count(), tri_count(), pair_buffer(), tri_buffer(), slot_points(), slots(), corr_x(), corr_y(), corr_z(), edges(), face_edges(), edge_faces(), swept(true), fast(), toi(), search() {
+}
+
+template<typename Real>
+SelfCollision<Real>::~SelfCollision() {
+  for (auto* v : { &rest_x, &rest_y, &rest_z, &corr_x, &corr_y, &corr_z, &toi }) {
+    v->clear();
+    v->shrink_to_fit();
+  }
+  pairs.clear();
+  pairs.shrink_to_fit();
+  tris.clear();
+  tris.shrink_to_fit();
+  pair_buffer.clear();
+  pair_buffer.shrink_to_fit();
+  tri_buffer.clear();
+  tri_buffer.shrink_to_fit();
+  edges.clear();
+  edges.shrink_to_fit();
+  face_edges.clear();
+  face_edges.shrink_to_fit();
+  edge_faces.clear();
+  edge_faces.shrink_to_fit();
+}
+
+template<typename Real>
+void SelfCollision<Real>::Init(const Points<Real>& points, const std::vector<std::uint32_t>& triangles, Real in_thickness) {
+  Real max_edge = (Real)0.0;
+  for(size_t f = 0; f + 2 < triangles.size(); f += 3) {
+    for(int k = 0; k < 3; k++) {
+      max_edge = std::max(max_edge, glm::length(points.Position(triangles[f + k]) - points.Position(triangles[f + (k + 1) % 3])));
+    }
+  }
+  thickness = in_thickness;
+  radius    = thickness * (Real)2.0 + max_edge * (Real)0.5774; // every point of a triangle is within max_edge / sqrt(3) of a corner
+  rest_x    = points.pos_x;
+  rest_y    = points.pos_y;
+  rest_z    = points.pos_z;
+  std::vector<std::uint64_t> keys(triangles.size()); // lower point << 32 | higher point, << 32 again for the face edge
+  for(size_t k = 0; k < triangles.size(); k++) {
+    std::uint64_t a = triangles[k], b = triangles[k - k % 3 + (k + 1) % 3];
+    keys[k] = std::min(a, b) << 32 | std::max(a, b);
+  }
+  std::vector<int> order(keys.size());
+  for(int k = 0; k < (int)order.size(); k++) {
+    order[k] = k;
+  }
+  std::sort(order.begin(), order.end(), [&](int a, int b) { return (keys[a] != keys[b]) ? (keys[a] < keys[b]) : (a < b); });
+  edges.clear();
+  edge_faces.clear();
+  face_edges.resize(triangles.size());
+  for(size_t k = 0; k < order.size(); k++) {
+    if ((k == 0) || (keys[order[k]] != keys[order[k - 1]])) {
+      edges.push_back((std::uint32_t)(keys[order[k]] >> 32));
+      edges.push_back((std::uint32_t)keys[order[k]]);
+      edge_faces.push_back(order[k] / 3);
+    }
+    face_edges[order[k]] = (int)edges.size() / 2 - 1;
+  }
+}
+
+template<typename Real>
+void SelfCollision<Real>::Find(ThreadPool* pool, const Points<Real>& points, const std::vector<std::uint32_t>& triangles,
+                               const std::vector<int>& vert_face_offsets, const std::vector<int>& vert_faces,
+                               const std::vector<int>* tiles, int tile_size) {
+  const int  MIN_GRAIN = 256;
+  const int  num       = points.Size();
+  const Real margin    = thickness * (Real)2.0; // contacts closer than thickness plus the motion of the remaining passes
+  const Real radius2   = radius * radius;
+  auto       rest      = [&](int i) { return Vec3(rest_x[i], rest_y[i], rest_z[i]); };
+  hash.Build(pool, points, radius);
+  pair_count.assign(num + 1, 0);
+  tri_count.assign(num + 1, 0);
+  pair_buffer.resize((size_t)num * MAX_PAIR);
+  tri_buffer.resize((size_t)num * MAX_TRI);
+  if (tiles != nullptr) {
+    search.assign((num + tile_size - 1) / tile_size, 0);
+    for(int t : *tiles) {
+      search[t] = 1;
+    }
+  }
+  auto searched = [&](int j) { return (tiles == nullptr) || (search[j / tile_size] != 0); };
+  for_tiles(pool, num, tiles, tile_size, MIN_GRAIN, [&](int begin, int end) {
+    for(int i = begin; i < end; i++) {
+      Vec3           x        = points.Position(i);
+      Vec3           x0       = rest(i);
+      std::uint32_t* pair_out = &pair_buffer[(size_t)i * MAX_PAIR];
+      std::uint32_t* tri_out  = &tri_buffer[(size_t)i * MAX_TRI];  // face << 1 | behind
+      int            np       = 0;
+      int            nt       = 0;
+      hash.Query(x, [&](int j) {
+        Vec3 xj = points.Position(j);
+        if ((glm::dot(x - xj, x - xj) >= radius2) || (glm::dot(x0 - rest(j), x0 - rest(j)) < radius2)) { // i itself included
+          return;
+        }
+        if (((j > i) || !searched(j)) && (np < MAX_PAIR) && (glm::dot(x - xj, x - xj) < margin * margin) && (std::find(pair_out, pair_out + np, (std::uint32_t)j) == pair_out + np)) {
+          pair_out[np++] = (std::uint32_t)j;
+        }
+        for(int k = vert_face_offsets[j]; (k < vert_face_offsets[j + 1]) && (nt < MAX_TRI); k++) {
+          const std::uint32_t  f = (std::uint32_t)vert_faces[k];
+          const std::uint32_t* v = &triangles[f * 3];
+          if (std::find_if(tri_out, tri_out + nt, [&](std::uint32_t t) { return (t >> 1) == f; }) != tri_out + nt) {
+            continue;
+          }
+          bool near_at_rest = false;
+          for(int c = 0; c < 3; c++) {
+            near_at_rest |= glm::dot(x0 - rest(v[c]), x0 - rest(v[c])) < radius2;
+          }
+          Vec3 a = points.Position(v[0]), b = points.Position(v[1]), c = points.Position(v[2]);
+          Vec3 bary;
+          if (near_at_rest || !barycentric(x, a, b, c, bary) || (glm::min(bary.x, glm::min(bary.y, bary.z)) < (Real)0.0)) {
+            continue;
+          }
+          Real dist = glm::dot(x - a, glm::normalize(glm::cross(b - a, c - a)));
+          if (std::abs(dist) < margin) {
+            tri_out[nt++] = (f << 1) | ((dist < (Real)0.0) ? 1u : 0u);
+          }
+        }
+      });
+      pair_count[i] = np;
+      tri_count[i]  = nt;
+    }
+  });
+  int num_pair = 0, num_tri = 0;
+  for(int i = 0; i <= num; i++) { // exclusive scan, count[num] is the total
+    int np = pair_count[i], nt = tri_count[i];
+    pair_count[i] = num_pair;
+    tri_count[i]  = num_tri;
+    num_pair     += np;
+    num_tri      += nt;
+  }
+  pairs.resize((size_t)num_pair * 2);
+  tris.resize(num_tri);
+  slot_points.resize((size_t)num_pair * 2 + (size_t)num_tri * 4);
+  ParallelFor(pool, 0, num, MIN_GRAIN, [&](int begin, int end) {
+    for(int i = begin; i < end; i++) {
+      for(int k = 0; k < pair_count[i + 1] - pair_count[i]; k++) {
+        int p = pair_count[i] + k;
+        pairs[p * 2]           = slot_points[p * 2]     = (std::uint32_t)i;
+        pairs[p * 2 + 1]       = slot_points[p * 2 + 1] = pair_buffer[(size_t)i * MAX_PAIR + k];
+      }
+      for(int k = 0; k < tri_count[i + 1] - tri_count[i]; k++) {
+        int           t    = tri_count[i] + k;
+        std::uint32_t code = tri_buffer[(size_t)i * MAX_TRI + k];
+        tris[t].point = (std::uint32_t)i;
+        tris[t].tri   = code >> 1;
+        tris[t].side  = (code & 1) ? (Real)-1.0 : (Real)1.0;
+        std::uint32_t* slot = &slot_points[(size_t)num_pair * 2 + (size_t)t * 4];
+        slot[0] = (std::uint32_t)i;
+        for(int c = 0; c < 3; c++) {
+          slot[c + 1] = triangles[tris[t].tri * 3 + c];
+        }
+      }
+    }
+  });
+  slots.Sort(pool, slot_points.data(), (int)slot_points.size(), num);
+  for (auto* v : { &corr_x, &corr_y, &corr_z }) {
+    v->resize(slot_points.size());
+  }
+}
+
+template<typename Real>
+Real SelfCollision<Real>::Solve(ThreadPool* pool, Points<Real>& points, const std::vector<std::uint32_t>& triangles) {
+  const int MIN_GRAIN = 1024;
+  const int num_pair  = (int)pairs.size() / 2;
+  const int num_tri   = (int)tris.size();
+  auto      max       = [](Real a, Real b) { return std::max(a, b); };
+  auto      store     = [&](size_t slot, const Vec3& c) { corr_x[slot] = c.x; corr_y[slot] = c.y; corr_z[slot] = c.z; };
+  if (slot_points.empty()) {
+    return (Real)0.0;
+  }
+  // C = |xi - xj| - thickness >= 0
+  Real depth = ParallelReduce(pool, 0, num_pair, MIN_GRAIN, (Real)0.0, [&](int begin, int end) {
+    Real max_depth = (Real)0.0;
+    for(int p = begin; p < end; p++) {
+      std::uint32_t i    = pairs[p * 2], j = pairs[p * 2 + 1];
+      Vec3          d    = points.Position(i) - points.Position(j);
+      Real          len  = glm::length(d);
+      Real          C    = len - thickness;
+      Real          wsum = points.inv_mass[i] + points.inv_mass[j];
+      Vec3          ci((Real)0.0), cj((Real)0.0);
+      if ((C < (Real)0.0) && (len > (Real)FLT_EPSILON) && (wsum > (Real)FLT_EPSILON)) {
+        Vec3 n = d * (-C / (wsum * len));
+        ci        = n * points.inv_mass[i];
+        cj        = n * -points.inv_mass[j];
+        max_depth = std::max(max_depth, -C);
+      }
+      store((size_t)p * 2,     ci);
+      store((size_t)p * 2 + 1, cj);
+    }
+    return max_depth;
+  }, max);
+  // C = side * dot(x - a, n) - thickness >= 0 while x projects inside the triangle, n held constant
+  depth = std::max(depth, ParallelReduce(pool, 0, num_tri, MIN_GRAIN, (Real)0.0, [&](int begin, int end) {
+    Real max_depth = (Real)0.0;
+    for(int t = begin; t < end; t++) {
+      const TriContact&    tc   = tris[t];
+      const std::uint32_t* v    = &triangles[tc.tri * 3];
+      const size_t         slot = pairs.size() + (size_t)t * 4;
+      Vec3 x = points.Position(tc.point);
+      Vec3 a = points.Position(v[0]), b = points.Position(v[1]), c = points.Position(v[2]);
+      Vec3 n = glm::cross(b - a, c - a);
+      Vec3 bary((Real)0.0);
+      Real len = glm::length(n);
+      Real C   = (Real)0.0;
+      if ((len > (Real)FLT_EPSILON) && barycentric(x, a, b, c, bary) && (glm::min(bary.x, glm::min(bary.y, bary.z)) >= (Real)0.0)) {
+        n *= tc.side / len;
+        C  = glm::dot(x - a, n) - thickness;
+      }
+      Real w[4] = { points.inv_mass[tc.point], points.inv_mass[v[0]], points.inv_mass[v[1]], points.inv_mass[v[2]] };
+      Real wsum = w[0] + w[1] * bary.x * bary.x + w[2] * bary.y * bary.y + w[3] * bary.z * bary.z;
+      if ((C < (Real)0.0) && (wsum > (Real)FLT_EPSILON)) {
+        Vec3 dir = n * (-C / wsum);
+        store(slot,     dir *  w[0]);
+        store(slot + 1, dir * -(w[1] * bary.x));
+        store(slot + 2, dir * -(w[2] * bary.y));
+        store(slot + 3, dir * -(w[3] * bary.z));
+        max_depth = std::max(max_depth, -C);
+      } else {
+        for(int k = 0; k < 4; k++) {
+          store(slot + k, Vec3((Real)0.0));
+        }
+      }
+    }
+    return max_depth;
+  }, max));
+  // every point averages its active slots
+  ParallelFor(pool, 0, points.Size(), MIN_GRAIN, [&](int begin, int end) {
+    for(int i = begin; i < end; i++) {
+      Vec3 sum((Real)0.0);
+      int  count = 0;
+      for(int k = slots.offsets[i]; k < slots.offsets[i + 1]; k++) {
+        int s = slots.items[k];
+        if ((corr_x[s] != (Real)0.0) || (corr_y[s] != (Real)0.0) || (corr_z[s] != (Real)0.0)) {
+          sum += Vec3(corr_x[s], corr_y[s], corr_z[s]);
+          count++;
+        }
+      }
+      if (count > 0) {
+        sum /= (Real)count;
+        points.pos_x[i] += sum.x;
+        points.pos_y[i] += sum.y;
+        points.pos_z[i] += sum.z;
+      }
+    }
+  });
+  return depth;
+}
+
+template<typename Real>
+int SelfCollision<Real>::Sweep(ThreadPool* pool, Points<Real>& points, const std::vector<std::uint32_t>& triangles,
+                               const std::vector<int>* tiles, int tile_size) {
+  const int  MIN_GRAIN = 256;
+  const int  num       = points.Size();
+  const int  num_face  = (int)triangles.size() / 3;
+  const int  num_edge  = (int)edges.size() / 2;
+  const Real eta       = thickness * (Real)0.1;
+  const Real REWIND    = (Real)0.8; // fraction of the time of impact kept
+  auto       prev      = [&](std::uint32_t i) { return Vec3(points.prev_x[i], points.prev_y[i], points.prev_z[i]); };
+  auto       concat    = [](std::vector<Impact> a, const std::vector<Impact>& b) { a.insert(a.end(), b.begin(), b.end()); return a; };
+  // layers Find and Solve keep thickness apart only cross if the points of a pair move thickness relative to each other,
+  // so one of them moves half of it relative to the mean motion. only pairs with such a fast point are tested, found
+  // from the fast side, and a sheet moving as a whole has none
+  int num_search = num;
+  if (tiles != nullptr) {
+    num_search = 0;
+    for(int t : *tiles) {
+      num_search += std::min((t + 1) * tile_size, num) - t * tile_size;
+    }
+  }
+  Vec3 mean = reduce_tiles(pool, num, tiles, tile_size, MIN_GRAIN, Vec3((Real)0.0), [&](int begin, int end) {
+    Vec3 sum((Real)0.0);
+    for(int i = begin; i < end; i++) {
+      sum += points.Position(i) - prev(i);
+    }
+    return sum;
+  }, [](const Vec3& a, const Vec3& b) { return a + b; }) / (Real)std::max(num_search, 1);
+  fast.assign(num, 0);
+  int num_fast = reduce_tiles(pool, num, tiles, tile_size, MIN_GRAIN, 0, [&](int begin, int end) {
+    int count = 0;
+    for(int i = begin; i < end; i++) {
+      Vec3 d  = points.Position(i) - prev(i) - mean;
+      fast[i] = (glm::dot(d, d) * (Real)4.0 >= thickness * thickness) ? 1 : 0;
+      count  += fast[i];
+    }
+    return count;
+  }, [](int a, int b) { return a + b; });
+  if (num_fast == 0) {
+    return 0;
+  }
+  toi.assign(num, (Real)1.0);
+  int num_impact = 0;
+  for(int round = 0; round < MAX_ROUND; round++) {
+    auto moved = [&](const std::uint32_t* p) { // a pair none of whose points moved back has the motion it had last round
+      return (round == 0) || (toi[p[0]] < (Real)1.0) || (toi[p[1]] < (Real)1.0) || (toi[p[2]] < (Real)1.0) || (toi[p[3]] < (Real)1.0);
+    };
+    // p[0, na) against p[na, 4) unless it shares a point, is left to the other side, or is apart all the step
+    auto test = [&](const std::uint32_t* p, int na, const Vec3& lo, const Vec3& hi, std::vector<Impact>& found) {
+      Vec3   x0[4], x1[4];
+      Vec3   plo(std::numeric_limits<Real>::max()), phi(std::numeric_limits<Real>::lowest()); // swept box of p[na, 4)
+      Impact impact;
+      for(int i = 0; i < na; i++) {
+        for(int j = na; j < 4; j++) {
+          if (p[i] == p[j]) {
+            return;
+          }
+        }
+      }
+      if (!moved(p)) {
+        return;
+      }
+      for(int c = 0; c < 4; c++) {
+        x0[c] = prev(p[c]);
+        x1[c] = points.Position(p[c]);
+        if (c >= na) {
+          plo = glm::min(plo, glm::min(x0[c], x1[c]));
+          phi = glm::max(phi, glm::max(x0[c], x1[c]));
+        }
+      }
+      if (glm::any(glm::lessThan(phi, lo)) || glm::any(glm::lessThan(hi, plo))) {
+        return;
+      }
+      if (FirstImpact(x0, x1, na == 1, eta, impact.t)) {
+        std::copy(p, p + 4, impact.p);
+        found.push_back(impact);
+      }
+    };
+    swept.Refit(pool, points, triangles);
+    // items : fast points against triangles, triangles with a fast corner against slow points, edges with a fast end
+    // against edges, both ends fast only from the lower edge
+    std::vector<Impact> impacts = ParallelReduce(pool, 0, num + num_face + num_edge, MIN_GRAIN, std::vector<Impact>(), [&](int begin, int end) {
+      std::vector<Impact> found;
+      for(int q = begin; q < end; q++) {
+        int                  kind = (q < num) ? 0 : (q < num + num_face) ? 1 : 2;
+        const std::uint32_t* v    = (kind == 0) ? (const std::uint32_t*)nullptr : (kind == 1) ? &triangles[(q - num) * 3] : &edges[(q - num - num_face) * 2];
+        std::uint32_t        item[3];
+        int                  size = (kind == 0) ? 1 : (kind == 1) ? 3 : 2;
+        bool                 any  = false;
+        for(int c = 0; c < size; c++) {
+          item[c] = (kind == 0) ? (std::uint32_t)q : v[c];
+          any    |= fast[item[c]] != 0;
+        }
+        if (!any) {
+          continue;
+        }
+        Vec3 lo(std::numeric_limits<Real>::max()), hi(std::numeric_limits<Real>::lowest());
+        for(int c = 0; c < size; c++) {
+          lo = glm::min(lo, glm::min(prev(item[c]), points.Position(item[c])) - Vec3(eta));
+          hi = glm::max(hi, glm::max(prev(item[c]), points.Position(item[c])) + Vec3(eta));
+        }
+        swept.Query(lo, hi, [&](int f) {
+          const std::uint32_t* w = &triangles[f * 3];
+          if (kind == 0) {
+            std::uint32_t p[4] = { item[0], w[0], w[1], w[2] };
+            test(p, 1, lo, hi, found);
+          } else if (kind == 1) {
+            for(int c = 0; c < 3; c++) {
+              std::uint32_t p[4] = { w[c], item[0], item[1], item[2] };
+              if (!fast[w[c]]) { // fast points test themselves, a point of several triangles comes once per triangle
+                test(p, 1, lo, hi, found);
+              }
+            }
+          } else {
+            for(int k = 0; k < 3; k++) {
+              int           e    = face_edges[f * 3 + k];
+              std::uint32_t p[4] = { item[0], item[1], edges[e * 2], edges[e * 2 + 1] };
+              bool          both = fast[p[2]] || fast[p[3]];
+              if ((edge_faces[e] == f) && (!both || (e > q - num - num_face))) {
+                test(p, 2, lo, hi, found);
+              }
+            }
+          }
+        });
+      }
+      return found;
+    }, concat);
+    num_impact += (round == 0) ? (int)impacts.size() : 0;
+    std::fill(toi.begin(), toi.end(), (Real)1.0);
+    if (impacts.empty()) {
+      break;
+    }
+    for(const Impact& impact : impacts) {
+      for(std::uint32_t p : impact.p) {
+        toi[p] = std::min(toi[p], (round + 1 < MAX_ROUND) ? impact.t * REWIND : (Real)0.0);
+      }
+    }
+    ParallelFor(pool, 0, num, MIN_GRAIN, [&](int begin, int end) {
+      for(int i = begin; i < end; i++) {
+        if (toi[i] < (Real)1.0) {
+          Vec3 x = prev(i) + (points.Position(i) - prev(i)) * toi[i];
+          points.pos_x[i] = x.x;
+          points.pos_y[i] = x.y;
+          points.pos_z[i] = x.z;
+        }
+      }
+    });
+  }
+  return num_impact;
+}
+
+template class SelfCollision<float>;
+template class SelfCollision<double>;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core/spatial_hash.h"
+#include "core/bvh.h"
+
+// point-point and point-triangle contacts that keep the layers of a triangle surface thickness apart.
+// Find hashes the points once per step and keeps every candidate within a margin of thickness, every solver pass
+// then projects those (Solve). a pass is jacobi over correction slots : each contact writes its own slots and each
+// point gathers its own, so both the search and the passes run in parallel without write conflicts.
+// Sweep is the continuous counterpart for motion too fast for the margin, run on the prediction before Find
+template<typename Real>
+class SelfCollision {
+public:
+  typedef glm::vec<3, Real> Vec3;
+private:
+  static const int MAX_PAIR = 16;                        // candidates kept per point, the rest are dropped
+  static const int MAX_TRI  = 16;
+  static const int MAX_ROUND = 3;                        // sweep : detect and rewind rounds, the last rewinds to prev
+  struct Impact {                                        // sweep : vertex-triangle or edge-edge
+    Real          t;
+    std::uint32_t p[4];
+  };
+  struct TriContact {
+    std::uint32_t point;
+    std::uint32_t tri;
+    Real          side;                                  // +1 : point in front of the triangle when found, -1 : behind
+  };
+  Real                       thickness;
+  Real                       radius;                     // search radius, margin plus the largest rest edge for triangles
+  AlignedVector<Real>        rest_x, rest_y, rest_z;     // candidates within radius at rest are left to the constraints
+  SpatialHash<Real>          hash;
+  std::vector<std::uint32_t> pairs;                      // i < j, two words per contact
+  std::vector<TriContact>    tris;
+  std::vector<int>           pair_count, tri_count;      // find : candidates per point, then where they start
+  std::vector<std::uint32_t> pair_buffer, tri_buffer;    // find : MAX_PAIR, MAX_TRI words per point
+  std::vector<std::uint32_t> slot_points;                // point of every correction slot, 2 per pair then 4 per triangle
+  CountingSort               slots;                      // slots of point i are slots.items[slots.offsets[i], slots.offsets[i+1])
+  AlignedVector<Real>        corr_x, corr_y, corr_z;     // per slot correction of the current pass
+  std::vector<std::uint32_t> edges;                      // unique triangle edges, two words each
+  std::vector<int>           face_edges;                 // three edges per triangle
+  std::vector<int>           edge_faces;                 // first triangle around every edge
+  TriangleBVH<Real>          swept;                      // triangles over prev -> pos
+  std::vector<std::uint8_t>  fast;                       // sweep : point moves half the thickness or more against the mean
+  AlignedVector<Real>        toi;                        // sweep : earliest impact of every point in the round
+  std::vector<std::uint8_t>  search;                     // find : 1 for the tiles searched
+public:
+  SelfCollision();
+  ~SelfCollision();
+  // rest state, points and triangles as the scene keeps them after ReorderPoints
+  void   Init(const Points<Real>& points, const std::vector<std::uint32_t>& triangles, Real in_thickness);
+  // contacts of the current positions, faces around point i are vert_faces[vert_face_offsets[i], vert_face_offsets[i+1]).
+  // tiles : only the points of these tiles of tile_size consecutive points search, every point when null. the others
+  // are still found by them, as points and as corners
+  void   Find(ThreadPool* pool, const Points<Real>& points, const std::vector<std::uint32_t>& triangles,
+              const std::vector<int>& vert_face_offsets, const std::vector<int>& vert_faces,
+              const std::vector<int>* tiles, int tile_size);
+  // one projection of every contact found, returns the deepest penetration
+  Real   Solve(ThreadPool* pool, Points<Real>& points, const std::vector<std::uint32_t>& triangles);
+  // continuous collision of the step prev -> pos : times where a point and a triangle or two edges become coplanar
+  // (Provot 1997, Collision and self-collision handling in cloth model dedicated to design garments), the swept BVH
+  // as broadphase. the points of every impact go back along their path to before the earliest one, a few rounds.
+  // returns the impacts of the first round. tiles as for Find : only their points count as fast
+  int    Sweep(ThreadPool* pool, Points<Real>& points, const std::vector<std::uint32_t>& triangles,
+               const std::vector<int>* tiles, int tile_size);
+  Real   GetThickness() const { return thickness; }
+  int    NumContacts()  const { return (int)(pairs.size() / 2 + tris.size()); }
+};
@@ -0,0 +1,35 @@
+#include "core/simd.h"
+#if defined(XPBD_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+  bool CpuHasAvx2() {
+#if !defined(XPBD_AVX2)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool fma     = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave || ((_xgetbv(0) & 6) != 6)) { // the os saves the ymm registers
+      return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+  }
+
+  bool use_avx2 = CpuHasAvx2();
+};
+
+bool UseAvx2() {
+  return use_avx2;
+}
+
+void EnableAvx2(bool enable) {
+  use_avx2 = enable && CpuHasAvx2();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// the library builds for the baseline ISA. vector kernels use SSE2 on x86, which every x86-64 cpu has, and with
+// XPBD_USE_AVX2 an 8 lane version of each kernel is compiled between XPBD_AVX2_BEGIN and XPBD_AVX2_END and
+// chosen at run time on cpus with AVX2 and FMA. nothing outside those regions is built for AVX2, so the
+// library runs on any x86-64 cpu
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define XPBD_SSE2
+#if defined(XPBD_USE_AVX2)
+#define XPBD_AVX2
+#endif
+#endif
+
+#if defined(XPBD_AVX2)
+#include <immintrin.h>
+#if defined(__clang__)
+#define XPBD_AVX2_BEGIN _Pragma("clang attribute push (__attribute__((target(\"avx2,fma\"))), apply_to = function)")
+#define XPBD_AVX2_END   _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define XPBD_AVX2_BEGIN _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,fma\")")
+#define XPBD_AVX2_END   _Pragma("GCC pop_options")
+#else // msvc takes the intrinsics of any ISA without flags
+#define XPBD_AVX2_BEGIN
+#define XPBD_AVX2_END
+#endif
+#elif defined(XPBD_SSE2)
+#include <emmintrin.h>
+#endif
+
+// true when the AVX2 kernels are compiled in, the cpu and os support them and EnableAvx2 did not turn them off
+bool UseAvx2();
+// false : the SSE2 kernels even on an AVX2 cpu, e.g. to compare both. true : back to what the cpu supports
+void EnableAvx2(bool enable);
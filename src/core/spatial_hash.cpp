@@ -0,0 +1,87 @@
+#include "core/spatial_hash.h"
+#include <algorithm>
+
+void CountingSort::Sort(ThreadPool* pool, const std::uint32_t* keys, int num, int num_bucket) {
+  const int MIN_GRAIN  = 4096;
+  const int SCAN_BLOCK = 4096;
+  if (capacity < num_bucket) {
+    counts.reset(new std::atomic<int>[num_bucket]);
+    capacity = num_bucket;
+  }
+  std::atomic<int>* count = counts.get();
+  ParallelFor(pool, 0, num_bucket, MIN_GRAIN, [&](int begin, int end) {
+    for(int b = begin; b < end; b++) {
+      count[b].store(0, std::memory_order_relaxed);
+    }
+  });
+  ParallelFor(pool, 0, num, MIN_GRAIN, [&](int begin, int end) {
+    for(int i = begin; i < end; i++) {
+      count[keys[i]].fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  // exclusive scan : block sums in parallel, a serial scan over the blocks, then every block in parallel again
+  const int num_block = (num_bucket + SCAN_BLOCK - 1) / SCAN_BLOCK;
+  block_sums.resize(num_block + 1);
+  offsets.resize(num_bucket + 1);
+  ParallelFor(pool, 0, num_block, 1, [&](int begin, int end) {
+    for(int k = begin; k < end; k++) {
+      int sum = 0;
+      for(int b = k * SCAN_BLOCK; b < std::min((k + 1) * SCAN_BLOCK, num_bucket); b++) {
+        sum += count[b].load(std::memory_order_relaxed);
+      }
+      block_sums[k + 1] = sum;
+    }
+  });
+  block_sums[0] = 0;
+  for(int k = 0; k < num_block; k++) {
+    block_sums[k + 1] += block_sums[k];
+  }
+  ParallelFor(pool, 0, num_block, 1, [&](int begin, int end) {
+    for(int k = begin; k < end; k++) {
+      int sum = block_sums[k];
+      for(int b = k * SCAN_BLOCK; b < std::min((k + 1) * SCAN_BLOCK, num_bucket); b++) {
+        offsets[b] = sum;
+        sum       += count[b].load(std::memory_order_relaxed);
+        count[b].store(offsets[b], std::memory_order_relaxed); // fill cursor
+      }
+    }
+  });
+  offsets[num_bucket] = num;
+  items.resize(num);
+  ParallelFor(pool, 0, num, MIN_GRAIN, [&](int begin, int end) {
+    for(int i = begin; i < end; i++) {
+      items[count[keys[i]].fetch_add(1, std::memory_order_relaxed)] = i;
+    }
+  });
+  if ((pool != nullptr) && (pool->NumThreads() > 1)) { // chunks raced for the cursors, a serial fill is already ascending
+    ParallelFor(pool, 0, num_bucket, MIN_GRAIN, [&](int begin, int end) {
+      for(int b = begin; b < end; b++) {
+        if (offsets[b + 1] - offsets[b] > 1) {
+          std::sort(items.begin() + offsets[b], items.begin() + offsets[b + 1]);
+        }
+      }
+    });
+  }
+}
+
+template<typename Real>
+void SpatialHash<Real>::Build(ThreadPool* pool, const Points<Real>& points, Real in_spacing) {
+  const int MIN_GRAIN = 4096;
+  const int num       = points.Size();
+  std::uint32_t size = 1;
+  while (size < (std::uint32_t)std::max(num * 2, 1)) {
+    size <<= 1;
+  }
+  spacing = in_spacing;
+  mask    = size - 1;
+  keys.resize(num);
+  ParallelFor(pool, 0, num, MIN_GRAIN, [&](int begin, int end) {
+    for(int i = begin; i < end; i++) {
+      keys[i] = Bucket(Cell(points.Position(i)));
+    }
+  });
+  sort.Sort(pool, keys.data(), num, (int)size);
+}
+
+template class SpatialHash<float>;
+template class SpatialHash<double>;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "core/points.h"
+#include "core/thread_pool.h"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+// parallel counting sort : item i goes to bucket keys[i] < num_bucket, bucket b is items[offsets[b], offsets[b+1]).
+// counts are atomics and the buffers are kept between sorts, so a sort never allocates per bucket. items come out
+// ascending within a bucket whatever the thread count
+class CountingSort {
+  std::unique_ptr<std::atomic<int>[]> counts;   // per bucket count, then fill cursor
+  int                                 capacity;
+  std::vector<int>                    block_sums; // prefix scan, one per SCAN_BLOCK buckets
+public:
+  std::vector<int>                    offsets;
+  std::vector<int>                    items;
+  CountingSort() : counts(), capacity(0), block_sums(), offsets(), items() {}
+  void Sort(ThreadPool* pool, const std::uint32_t* keys, int num, int num_bucket);
+};
+
+// points hashed by grid cell into a table of at least 2 n buckets (Teschner 2003, Optimized Spatial Hashing for
+// Collision Detection of Deformable Objects). rebuilt from scratch with one counting sort, no per cell storage
+template<typename Real>
+class SpatialHash {
+public:
+  typedef glm::vec<3, Real> Vec3;
+private:
+  Real                       spacing;
+  std::uint32_t              mask;      // table size - 1, a power of two
+  std::vector<std::uint32_t> keys;      // bucket of every point
+  CountingSort               sort;
+public:
+  SpatialHash() : spacing((Real)1.0), mask(0), keys(), sort() {}
+  glm::ivec3    Cell(const Vec3& x) const { return glm::ivec3(glm::floor(x / spacing)); }
+  std::uint32_t Bucket(const glm::ivec3& c) const {
+    return (((std::uint32_t)c.x * 92837111u) ^ ((std::uint32_t)c.y * 689287499u) ^ ((std::uint32_t)c.z * 283923481u)) & mask;
+  }
+  // cells of in_spacing, a query then finds every point closer than in_spacing
+  void Build(ThreadPool* pool, const Points<Real>& points, Real in_spacing);
+  // func(j) for every point j hashed to the 27 cells around x, farther points of colliding cells included.
+  // two of the cells can share a bucket, so a point may come twice
+  template<typename F>
+  void Query(const Vec3& x, F&& func) const {
+    glm::ivec3 c = Cell(x);
+    for(int z = -1; z <= 1; z++) {
+      for(int y = -1; y <= 1; y++) {
+        for(int w = -1; w <= 1; w++) {
+          std::uint32_t b = Bucket(c + glm::ivec3(w, y, z));
+          for(int e = sort.offsets[b]; e < sort.offsets[b + 1]; e++) {
+            func(sort.items[e]);
+          }
+        }
+      }
+    }
+  }
+};
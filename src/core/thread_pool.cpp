@@ -0,0 +1,89 @@
+#include "core/thread_pool.h"
+
+ThreadPool::ThreadPool(int num_threads) : workers(), deques(), mutex(), wake(), generation(0), pending(0), quit(false) {
+  Start(num_threads);
+}
+
+ThreadPool::~ThreadPool() {
+  Stop();
+}
+
+void ThreadPool::SetNumThreads(int num_threads) {
+  if (num_threads != NumThreads()) {
+    Stop();
+    Start(num_threads);
+  }
+}
+
+void ThreadPool::Start(int num_threads) {
+  num_threads = std::max(num_threads, 1);
+  quit        = false;
+  for (int i = 0; i < num_threads; i++) {
+    deques.emplace_back(new Deque());
+  }
+  for (int i = 1; i < num_threads; i++) {
+    workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+void ThreadPool::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    quit = true;
+  }
+  wake.notify_all();
+  for (auto& t : workers) {
+    t.join();
+  }
+  workers.clear();
+  deques.clear();
+}
+
+bool ThreadPool::Pop(int index, Chunk& out) { // own deque, newest first
+  Deque& dq = *deques[index];
+  std::lock_guard<std::mutex> lock(dq.mutex);
+  if (dq.head == dq.tail) {
+    return false;
+  }
+  out = dq.chunks[--dq.tail % MAX_CHUNKS];
+  return true;
+}
+
+bool ThreadPool::Steal(int index, Chunk& out) { // other deques, oldest first
+  int num_threads = NumThreads();
+  for (int i = 1; i < num_threads; i++) {
+    Deque& dq = *deques[(index + i) % num_threads];
+    std::lock_guard<std::mutex> lock(dq.mutex);
+    if (dq.head != dq.tail) {
+      out = dq.chunks[dq.head++ % MAX_CHUNKS];
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::RunOne(int index) {
+  Chunk c;
+  if (!Pop(index, c) && !Steal(index, c)) {
+    return false;
+  }
+  c.task->job(c.task->ctx, c.begin, c.end);
+  pending.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+void ThreadPool::WorkerLoop(int index) {
+  std::uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&] { return quit || (generation != seen); });
+      if (quit) {
+        return;
+      }
+      seen = generation;
+    }
+    while (RunOne(index)) {
+    }
+  }
+}
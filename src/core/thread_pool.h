@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+
+class ThreadPool {
+public:
+  static const int CHUNKS_PER_THREAD = 4;   // over-decomposition so idle workers have something to steal
+  static const int MAX_CHUNKS        = 256; // per deque, fixed so dispatching never allocates
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+  int  NumThreads() const { return (int)deques.size(); }
+  void SetNumThreads(int num_threads);
+  // func(begin, end) is called once per chunk, chunks hold at least min_grain items
+  template<typename F>
+  void ParallelFor(int begin, int end, int min_grain, F&& func) {
+    int count      = end - begin;
+    int num_chunks = std::min(NumThreads() * CHUNKS_PER_THREAD, count / std::max(min_grain, 1));
+    num_chunks     = std::min(num_chunks, NumThreads() * MAX_CHUNKS);
+    if ((num_chunks <= 1) || (NumThreads() == 1)) {
+      if (begin < end) { func(begin, end); }
+      return;
+    }
+    typedef typename std::remove_reference<F>::type Func;
+    Task task;
+    task.job = [](void* ctx, int b, int e) { (*static_cast<Func*>(ctx))(b, e); };
+    task.ctx = &func;
+    pending.store(num_chunks, std::memory_order_relaxed);
+    int num_threads = NumThreads();
+    for (int t = 0; t < num_threads; t++) { // contiguous chunks per deque, stealing takes from the far end
+      Deque& dq = *deques[t];
+      std::lock_guard<std::mutex> lock(dq.mutex);
+      for (int k = num_chunks * t / num_threads; k < num_chunks * (t + 1) / num_threads; k++) {
+        Chunk& c = dq.chunks[dq.tail++ % MAX_CHUNKS];
+        c.task   = &task;
+        c.begin  = begin + (int)((std::int64_t)count * k       / num_chunks);
+        c.end    = begin + (int)((std::int64_t)count * (k + 1) / num_chunks);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      generation++;
+    }
+    wake.notify_all();
+    while (pending.load(std::memory_order_acquire) != 0) {
+      if (!RunOne(0)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+private:
+  struct Task {
+    void (*job)(void*, int, int);
+    void* ctx;
+  };
+  struct Chunk {
+    const Task* task;
+    int         begin;
+    int         end;
+  };
+  struct Deque {
+    std::mutex    mutex;
+    Chunk         chunks[MAX_CHUNKS];
+    std::uint32_t head;
+    std::uint32_t tail;
+    Deque() : mutex(), head(0), tail(0) {}
+  };
+  std::vector<std::thread>              workers;
+  std::vector<std::unique_ptr<Deque>>   deques;
+  std::mutex                            mutex;
+  std::condition_variable               wake;
+  std::uint64_t                         generation;
+  std::atomic<int>                      pending;
+  bool                                  quit;
+  void Start(int num_threads);
+  void Stop();
+  bool Pop(int index, Chunk& out);
+  bool Steal(int index, Chunk& out);
+  bool RunOne(int index);
+  void WorkerLoop(int index);
+};
+
+// serial fallback when no pool is given
+template<typename F>
+void ParallelFor(ThreadPool* pool, int begin, int end, int min_grain, F&& func) {
+  if (pool) {
+    pool->ParallelFor(begin, end, min_grain, func);
+  } else if (begin < end) {
+    func(begin, end);
+  }
+}
+
+// func(begin, end) returns the partial result of one chunk, partials are folded with combine in no particular order
+template<typename T, typename F, typename C>
+T ParallelReduce(ThreadPool* pool, int begin, int end, int min_grain, T init, F&& func, C&& combine) {
+  std::mutex mutex;
+  T          result = init;
+  ParallelFor(pool, begin, end, min_grain, [&](int b, int e) {
+    T partial = func(b, e);
+    std::lock_guard<std::mutex> lock(mutex);
+    result = combine(result, partial);
+  });
+  return result;
+}
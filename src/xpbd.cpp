@@ -23,60 +23,36 @@
 #include "imgui.h"
 #include "imgui_impl_glut.h"
 #include "imgui_impl_opengl2.h"
+#include "core/scene_cloth.h"
+#include "core/scene_softbody.h"
+#include "core/collider.h"
 #include <vector>
 #include <iostream>
 #include <cstdint>
 #include <algorithm>
 #include <cfloat>
+#include <cstring>
 
 #define USE_TEST_SCENE (0)
-#define USE_DOUBLE     (0)
 #define USE_CAPTURE    (0)
 
-#if !(USE_DOUBLE)
-typedef float     Float;
-typedef glm::vec3 Vec3;
-typedef glm::vec2 Vec2;
-typedef glm::quat Quat;
-typedef glm::mat3 Mat3;
-#else
-typedef double       Float;
-typedef glm::f64vec3 Vec3;
-typedef glm::f64vec2 Vec2;
-typedef glm::dquat   Quat;
-typedef glm::dmat3   Mat3;
-#endif
-
-namespace {
-  Float      FIXED_DT  = (Float)(1.0 / 30.0);
-  Float      GRAVITY   = (Float)9.8;
-  enum eMat : int {
-    eMat_Concrete,
-    eMat_Wood,
-    eMat_Leather,
-    eMat_Tendon,
-    eMat_Rubber,
-    eMat_Muscle,
-    eMat_Fat,
-    eMat_Max,
-  };
-  static const float MAT_COMPLIANCE[eMat_Max] = { // Miles Macklin's blog (http://blog.mmacklin.com/2016/10/12/xpbd-slides-and-stiffness/)
-    0.00000000004f, // 0.04 x 10^(-9) (M^2/N) Concrete
-    0.00000000016f, // 0.16 x 10^(-9) (M^2/N) Wood
-    0.000000001f,   // 1.0  x 10^(-8) (M^2/N) Leather
-    0.000000002f,   // 0.2  x 10^(-7) (M^2/N) Tendon
-    0.0000001f,     // 1.0  x 10^(-6) (M^2/N) Rubber
-    0.00002f,       // 0.2  x 10^(-3) (M^2/N) Muscle
-    0.0001f,        // 1.0  x 10^(-3) (M^2/N) Fat
-  };
-};
-
 namespace Cloth {
   Vec3       POS((Float)0.0, (Float)2.5, (Float)0.0);
   Vec2       WIDTH((Float)2.0, (Float)2.0);
   glm::ivec2 DIVISION(16, 16);
 };
 
+namespace SoftBody {
+  Vec3       POS((Float)0.0, (Float)2.0, (Float)0.0);
+  Vec3       WIDTH((Float)2.0, (Float)0.5, (Float)0.5);
+  glm::ivec3 DIVISION(16, 4, 4);
+};
+
+namespace Collision {
+  glm::vec3  SPHERE_POS(0.0f, 1.5f, 1.8f); // under the falling cloth
+  float      SPHERE_RADIUS = 0.5f;
+};
+
 struct Material {
   GLfloat ambient[4];
   GLfloat diffuse[4];
@@ -230,20 +206,7 @@ struct Shadow {
   float v[4][4];
 };
 
-struct Context;
-
-class Scene {
-public:
-  enum {
-    eCloth,
-    eNum,
-  };
-  virtual void Update(Context& context, Float dt) = 0;
-  virtual void Render(float alpha = 1.0f) = 0;
-  virtual ~Scene() {}
-};
-
-struct Context {
+struct Context : public Params {
   std::uint32_t       frame;
   float               time;
   DebugInfo           debug_info;
@@ -251,224 +214,33 @@ struct Context {
   Light               light;
   Shadow              floor_shadow;
   Scene*              scene;
-  int                 num_iteration;
-  int                 mat_compliance;
-  float               compliance;
-  Context() : frame(0), time(0.0f), debug_info(), floor(), light(), floor_shadow(), scene(nullptr), num_iteration(20), mat_compliance(eMat_Fat), compliance((Float)MAT_COMPLIANCE[mat_compliance]) {}
-};
-
-class Point{
-public:
-  Float inv_mass;
-  Vec3  position;
-  Vec3  prev_position;
-  Vec3  velocity;
-  Point(Float inv_m, Vec3& pos, Vec3& vel) : inv_mass(inv_m), position(pos), prev_position(pos), velocity(vel) {
-  };
-  Point();
-  void Predict(Float dt) {
-    if (inv_mass < FLT_EPSILON) {
-      return;
-    }
-    velocity  = position - prev_position;
-    velocity.y -= GRAVITY * dt;
-    prev_position = position;
-    position += velocity * dt;
-  }
-  void SolveVelocity(GLfloat dt) {
-    velocity  = position - prev_position;
-    velocity *= inv_mass;
-  }
-  void Render(GLdouble radius, Material& mat, float alpha) {
-    glPushMatrix();
-      glTranslatef((GLfloat)position.x, (GLfloat)position.y, (GLfloat)position.z);
-      set_material(mat, alpha);
-      glutSolidSphere(radius, 16, 16);
-    glPopMatrix();
-  }
+  int                 scene_type;                 // Scene::eCloth, Scene::eSoftBody, applied on restart
+  int                 precision;                  // ePrecision of the scene, applied on restart
+  TetMesh             tet_mesh;                   // soft body, generated box or --mesh
+  int                 tet_model;                  // eTetModel of the soft body, applied on restart
+  int                 batch_mat[eConstraint_Max]; // 0 : Default, otherwise eMat + 1
+  Colliders           world;                      // Params::colliders points here while anything is enabled
+  bool                collide_floor;
+  bool                collide_sphere;
+  int                 grab_point;                 // point under the mouse while the left button is down, -1 : none
+  GLdouble            grab_depth;                 // window depth the grabbed point is dragged at
+  Context() : Params(), frame(0), time(0.0f), debug_info(), floor(), light(), floor_shadow(), scene(nullptr), scene_type(Scene::eCloth), precision(ePrecision_Float), tet_mesh(), tet_model(eTetModel_Volume), batch_mat(), world(), collide_floor(true), collide_sphere(true), grab_point(-1), grab_depth(0.0) {}
 };
 
 Context g_Context;
 
-class DistanceConstraint {
-public:
-  Point* point0;
-  Point* point1;
-  Float  rest_length;
-  Float  compliance;
-  Float  lambda;
-  DistanceConstraint(Point* p0, Point* p1, Float in_compliance) : point0(p0), point1(p1), rest_length((Float)0.0), compliance(in_compliance), lambda((Float)0.0) {
-    rest_length = glm::length(point1->position - point0->position);
-  }
-  void LambdaInit() {
-    lambda = 0.0f; // reset every time frame
-  }
-  void SolvePosition(Float dt){
-    Float w = point0->inv_mass + point1->inv_mass;
-    if (w < FLT_EPSILON) {
-      return;
-    }
-    Vec3  grad = point0->position - point1->position;
-    Float    d = glm::length(grad);
-    compliance = g_Context.compliance;
-    compliance /= dt * dt;    // a~
-    GLfloat constraint = d- rest_length; // Cj(x)
-    GLfloat dlambda    = (-constraint - (GLfloat)compliance * lambda) / (w + compliance); // eq.18
-    Vec3    corr    = dlambda * grad / (d + FLT_EPSILON);                     // eq.17
-    lambda += dlambda;
-    point0->position += (corr * point0->inv_mass);
-    point1->position -= (corr * point1->inv_mass);
-  }
-};
-
-class DihedralConstraint {
-public:
-  DihedralConstraint() {
-    
-  }
-  void SolvePos() {
-    
-  }
-};
-
-class VolumeConstraint {
-  VolumeConstraint() {
-    
-  }
-  void SolvePos() {
-    
-  }
-};
-
-class SceneCloth : public Scene {
-private:
-  glm::ivec2                      size;
-  std::vector<Point>              points;
-  std::vector<Vec3>               normals;
-  std::vector<DistanceConstraint> constraints;
-  Point* GetPoint(int w, int h)  {return &points[ h * size.x + w ]; }
-  Vec3*  GetNormal(int w, int h) {return &normals[ h * size.x + w ]; }
-  void   MakeConstraint(Point* p1, Point* p2, Float in_compliance) { constraints.push_back(DistanceConstraint(p1, p2, in_compliance)); }
-  void   CalcNormal() {
-    normals.clear();
-    normals.shrink_to_fit();
-    normals.resize(size.x * size.y);
-    for(int w = 0; w < size.x - 1; w++){
-      for(int h = 0; h < size.y - 1; h++){
-        glm::vec3 v0 = glm::vec3(GetPoint(w,   h  )->position);
-        glm::vec3 v1 = glm::vec3(GetPoint(w  , h+1)->position);
-        glm::vec3 v2 = glm::vec3(GetPoint(w+1, h  )->position);
-        glm::vec3 v3 = glm::vec3(GetPoint(w+1, h+1)->position);
-        glm::vec3 f0 = glm::normalize(glm::cross(v2-v0, v1-v0));
-        glm::vec3 f1 = glm::normalize(glm::cross(v3-v2, v1-v2));
-        glm::vec3* n0 = GetNormal(w,   h  );
-        glm::vec3* n1 = GetNormal(w,   h+1);
-        glm::vec3* n2 = GetNormal(w+1, h  );
-        glm::vec3* n3 = GetNormal(w+1, h+1);
-        *n0 += f0;
-        *n1 += f0;
-        *n2 += f0;
-        *n1 += f1;
-        *n2 += f1;
-        *n3 += f1;
-      }
-    }
-    for(auto& n : normals) {
-      n = glm::normalize(n);
-    }
-  }
-  void   DrawTriangle(Point* p1, Point* p2, Point* p3, glm::vec3* n0, glm::vec3* n1, glm::vec3* n2){
-    glm::vec3 v1(p1->position);
-    glm::vec3 v2(p2->position);
-    glm::vec3 v3(p3->position);
-    glNormal3fv((GLfloat*)n0);
-    glVertex3fv((GLfloat*)&v1);
-    glNormal3fv((GLfloat*)n1);
-    glVertex3fv((GLfloat*)&v2);
-    glNormal3fv((GLfloat*)n2);
-    glVertex3fv((GLfloat*)&v3);
-  }
-public:
-  SceneCloth(Vec2& width, glm::ivec2& in_div, Vec3& in_pos, Float in_compliance) : size(in_div.x, in_div.y), points(), normals(), constraints() {
-    points.reserve(size.x * size.y);
-    for(int w = 0; w < size.x; w++){
-      for(int h = 0; h < size.y; h++){
-        Vec3 pos( width.x  * ((Float)w/(Float)(size.x-1)) - width.x  * 0.5f,
-                  0.0f,
-                  width.y * ((Float)h/(Float)(size.y-1)) + width.y * 0.5f );
-        //Vec2 uv((Float)(w) / (size.x - 1), (Float)(h) / (size.y - 1));
-        GLfloat inv_mass = 1.0f;
-        Vec3 vel((Float)0.0, (Float)0.0, (Float)0.0);
-        if ((h == 0) && (w == 0)          ||
-            (h == 0) && (w == size.x - 1)) {
-          inv_mass = 0.0f; // fix only edge point
-        }
-        pos += in_pos;
-        points.push_back(Point(inv_mass, pos, vel));
-      }
-    }
-    for(int w = 0; w < size.x; w++){
-      for(int h = 0; h < size.y; h++){               // structual constraint
-        if  (w < size.x - 1){ MakeConstraint(GetPoint(w, h), GetPoint(w+1, h  ), in_compliance); }
-        if  (h < size.y - 1){ MakeConstraint(GetPoint(w, h), GetPoint(w,   h+1), in_compliance); }
-        if ((w < size.x - 1) && (h < size.y - 1) ) { // shear constraint
-          MakeConstraint(GetPoint(w,   h), GetPoint(w+1, h+1), in_compliance);
-          MakeConstraint(GetPoint(w+1, h), GetPoint(w,   h+1), in_compliance);
-        }
-      }
-    }
-    for(int w = 0; w < size.x; w++){
-      for(int h = 0; h < size.y; h++){               // bend constraint
-        if  (w < size.x  - 2){ MakeConstraint(GetPoint(w, h), GetPoint(w+2, h  ), in_compliance); }
-        if  (h < size.y  - 2){ MakeConstraint(GetPoint(w, h), GetPoint(w,   h+2), in_compliance); }
-        if ((w < size.x  - 2) && (h < size.y - 2)) {
-          MakeConstraint(GetPoint(w,   h), GetPoint(w+2, h+2), in_compliance);
-          MakeConstraint(GetPoint(w+2, h), GetPoint(w,   h+2), in_compliance);
-        }
-      }
-    }
-    CalcNormal();
-  }
-  ~SceneCloth() {
-    points.clear();
-    points.shrink_to_fit();
-    normals.clear();
-    normals.shrink_to_fit();
-    constraints.clear();
-    constraints.shrink_to_fit();
-  }
-  virtual void Update(Context& ctx, Float dt) {
-    for (auto& p : points) {
-      p.Predict(dt);
-    }
-    for(auto& c : constraints) {
-      c.LambdaInit();
-    }
-    for(int i = 0; i < ctx.num_iteration; i++) {
-      for(auto& c : constraints) {
-        c.SolvePosition(dt);
-      }
-    }
-    CalcNormal();
-  }
-  virtual void Render(float alpha = 1.0f) {
-    glFrontFace(GL_CW);
-    glBegin(GL_TRIANGLES);
-    int col_idx = 0;
-    for(int w = 0; w < size.x - 1; w++){
-      for(int h = 0; h < size.y - 1; h++){
-        set_material(mat_emerald, alpha, GL_FRONT);
-        set_material(mat_bronze,  alpha, GL_BACK);
-        DrawTriangle(GetPoint (w,   h), GetPoint (w, h+1), GetPoint (w+1, h),
-                     GetNormal(w,   h), GetNormal(w, h+1), GetNormal(w+1, h));
-        DrawTriangle(GetPoint (w+1, h), GetPoint (w, h+1), GetPoint (w+1, h+1),
-                     GetNormal(w+1, h), GetNormal(w, h+1), GetNormal(w+1, h+1));
-      }
-    }
-    glEnd();
-    glFrontFace(GL_CCW);
-  }
-};
+void render_mesh(const Scene& scene, float alpha = 1.0f) {
+  static std::vector<float> vertices;
+  scene.FillVertexBuffer(vertices);
+  glFrontFace(GL_CW);
+  set_material(mat_emerald, alpha, GL_FRONT);
+  set_material(mat_bronze,  alpha, GL_BACK);
+  glInterleavedArrays(GL_N3F_V3F, 0, vertices.data());
+  glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(vertices.size() / 6));
+  glDisableClientState(GL_NORMAL_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glFrontFace(GL_CCW);
+}
 
 void write_ppm(GLubyte* buff, GLenum format) {
   int w = glutGet(GLUT_WINDOW_WIDTH);
@@ -622,6 +394,10 @@ void finalize_imgui() {
 
 void finalize(void) {
   finalize_imgui();
+  delete g_Context.scene;
+  g_Context.scene = nullptr;
+  delete g_Context.thread_pool;
+  g_Context.thread_pool = nullptr;
   return;
 }
 
@@ -657,6 +433,27 @@ void calc_shadow_matrix(Shadow* shadow, Plane& plane, Light& light) {
   shadow->v[3][3] = dot - light.v[3] * plane.v[3];
 }
 
+void update_colliders() {
+  g_Context.world.Clear();
+  if (g_Context.collide_floor) {
+    g_Context.world.AddPlane(g_Context.floor.v);
+  }
+  if (g_Context.collide_sphere) {
+    g_Context.world.AddSphere(Collision::SPHERE_POS, Collision::SPHERE_RADIUS);
+  }
+  g_Context.colliders = g_Context.world.Empty() ? nullptr : &g_Context.world;
+  if (g_Context.scene) { // cloth asleep on a removed floor would hang in the air
+    g_Context.scene->Wake();
+  }
+}
+
+Scene* new_scene() {
+  if (g_Context.scene_type == Scene::eSoftBody) {
+    return NewSceneSoftBody(g_Context.precision, g_Context.tet_mesh, g_Context.tet_model, SoftBody::POS);
+  }
+  return NewSceneCloth(g_Context.precision, Cloth::WIDTH, Cloth::DIVISION, Cloth::POS);
+}
+
 void initialize(int argc, char* argv[]) {
   glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
   glClearAccum(0.0f, 0.0f, 0.0f, 0.0f); 
@@ -709,7 +506,24 @@ void initialize(int argc, char* argv[]) {
   glm::vec3 v1(+1.0f, 0.0f,  0.0f);
   glm::vec3 v2(+1.0f, 0.0f, -1.0f);
   find_plane(&g_Context.floor, v0, v1, v2);
-  g_Context.scene = new SceneCloth(Cloth::WIDTH, Cloth::DIVISION, Cloth::POS, g_Context.compliance);
+  update_colliders();
+  for(int i = 1; i + 1 < argc; i++) {
+    if ((strcmp(argv[i], "--threads") == 0) || (strcmp(argv[i], "-t") == 0)) {
+      g_Context.num_thread = std::max(atoi(argv[++i]), 1);
+    } else if (strcmp(argv[i], "--mesh") == 0) {
+      if (LoadTetGen(argv[++i], g_Context.tet_mesh)) {
+        g_Context.scene_type = Scene::eSoftBody;
+      } else {
+        fprintf(stderr, "cannot read %s.node/.ele\n", argv[i]);
+        g_Context.tet_mesh = TetMesh();
+      }
+    }
+  }
+  if (g_Context.tet_mesh.tets.empty()) {
+    g_Context.tet_mesh = MakeTetBox(SoftBody::WIDTH, SoftBody::DIVISION);
+  }
+  g_Context.thread_pool = new ThreadPool(g_Context.num_thread);
+  g_Context.scene = new_scene();
 }
 
 void restart() {
@@ -717,7 +531,8 @@ void restart() {
     delete g_Context.scene;
     g_Context.scene = nullptr;
   }
-  g_Context.scene = new SceneCloth(Cloth::WIDTH, Cloth::DIVISION, Cloth::POS, g_Context.compliance);
+  g_Context.scene      = new_scene();
+  g_Context.grab_point = -1;
 }
 
 void display_imgui() {
@@ -737,12 +552,74 @@ void display_imgui() {
     if (ImGui::Button("Restart")) {
       restart();
     }
-    ImGui::SliderInt  ("Iterations", &g_Context.num_iteration, 20, 160);
+    if (ImGui::Combo("Scene", &g_Context.scene_type, "Cloth\0Soft Body\0")) {
+      restart();
+    }
+    if ((g_Context.scene_type == Scene::eSoftBody) && ImGui::Combo("Model", &g_Context.tet_model, "Volume\0Neo-Hookean\0")) {
+      restart();
+    }
+    ImGui::Combo("Integrator", &g_Context.integrator, "Iterations\0Substeps\0");
+    if (g_Context.integrator == eIntegrator_Substep) {
+      ImGui::SliderInt("Substeps",   &g_Context.num_substep,   1, 160);
+    } else {
+      ImGui::SliderInt("Iterations", &g_Context.num_iteration, 5, 160);
+      ImGui::Checkbox("Chebyshev", &g_Context.chebyshev);
+      if (g_Context.chebyshev) {
+        ImGui::SliderFloat("Spectral Radius", &g_Context.spectral_radius, 0.0f, 0.999f, (g_Context.spectral_radius > 0.0f) ? "%.3f" : "auto");
+        if (g_Context.scene) {
+          ImGui::Text("rho: %.4f", g_Context.scene->GetStats().spectral_radius);
+        }
+      }
+      ImGui::SliderFloat("Tolerance", &g_Context.tolerance, 0.0f, 0.01f, (g_Context.tolerance > 0.0f) ? "%.2e" : "off", ImGuiSliderFlags_Logarithmic);
+    }
+    if (ImGui::Checkbox("Floor", &g_Context.collide_floor)) {
+      update_colliders();
+    }
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Sphere", &g_Context.collide_sphere)) {
+      update_colliders();
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("CCD", &g_Context.ccd);
+    if (g_Context.scene_type == Scene::eCloth) {
+      ImGui::Checkbox("Self Collision", &g_Context.self_collision);
+      ImGui::SameLine();
+      ImGui::Checkbox("Sleep", &g_Context.sleep);
+    }
+    if (g_Context.scene) {
+      ImGui::Text("Passes: %d  Residual: %.3e", g_Context.scene->GetStats().num_iteration, g_Context.scene->GetStats().residual);
+      if (g_Context.sleep && (g_Context.scene_type == Scene::eCloth)) {
+        ImGui::Text("Sleeping: %d points", g_Context.scene->GetStats().num_sleeping);
+      }
+    }
     if (ImGui::Combo("Material", &g_Context.mat_compliance, "Concrete\0Wood\0Leather\0Tendon\0Rubber\0Muscle\0Fat\0")) {
       g_Context.compliance = MAT_COMPLIANCE[g_Context.mat_compliance];
       restart();
     }
     ImGui::Text("Compliance: %0.12f", g_Context.compliance);
+    if (ImGui::Combo("Precision", &g_Context.precision, "Float\0Double\0Mixed\0")) {
+      restart();
+    }
+    if (ImGui::SliderInt("Threads", &g_Context.num_thread, 1, (int)std::max(1u, std::thread::hardware_concurrency()))) {
+      g_Context.thread_pool->SetNumThreads(g_Context.num_thread);
+    }
+    ImGui::Combo("Solver", &g_Context.solver, "Gauss-Seidel\0Jacobi\0");
+    if (g_Context.solver == eSolver_Jacobi) {
+      ImGui::SliderFloat("Relaxation", &g_Context.relaxation, 1.0f, 2.0f);
+    }
+    static const char* BATCH_NAME[eConstraint_Max] = { "Structural", "Shear", "Bend", "Volume", "Deviatoric", "Hydrostatic" };
+    for (int t = 0; t < eConstraint_Max; t++) {
+      if (!ImGui::TreeNode(BATCH_NAME[t])) {
+        continue;
+      }
+      BatchParams& batch = g_Context.batch[t];
+      if (ImGui::Combo("Material", &g_Context.batch_mat[t], "Default\0Concrete\0Wood\0Leather\0Tendon\0Rubber\0Muscle\0Fat\0")) {
+        batch.compliance = (g_Context.batch_mat[t] > 0) ? MAT_COMPLIANCE[g_Context.batch_mat[t] - 1] : -1.0f;
+      }
+      ImGui::SliderInt("Passes",   &batch.num_iteration, 0, 160, (batch.num_iteration > 0) ? "%d" : "all");
+      ImGui::SliderInt("Interval", &batch.interval,      1, 8);
+      ImGui::TreePop();
+    }
     ImGui::End();
   }
 
@@ -797,8 +674,15 @@ void render_scene(float alpha = 1.0f) {
     glPopMatrix();
   }
 #else
+  if (g_Context.collide_sphere) {
+    glPushMatrix();
+      glTranslatef(Collision::SPHERE_POS.x, Collision::SPHERE_POS.y, Collision::SPHERE_POS.z);
+      set_material(mat_pearl, alpha);
+      glutSolidSphere(Collision::SPHERE_RADIUS, 32, 32);
+    glPopMatrix();
+  }
   if (g_Context.scene) {
-    g_Context.scene->Render(alpha);
+    render_mesh(*g_Context.scene, alpha);
   }
 #endif
 }
@@ -848,6 +732,21 @@ void display_actor(float alpha = 1.0f) {
   render_scene();                 // actual draw
 }
 
+// camera of one depth of field sample, jitter 0 : the lens center
+void look_at(GLfloat jitter_x, GLfloat jitter_y) {
+  glm::vec3 pos(0.0f, 1.6f, 12.0f);
+  float eye_jitter = (pos.z - g_Context.debug_info.focus) / pos.z;
+  eye_jitter = (eye_jitter < 0.1f) ? 0.1f : eye_jitter;
+  pos.x += g_Context.debug_info.dof * jitter_x * eye_jitter;
+  pos.y += g_Context.debug_info.dof * jitter_y * eye_jitter;
+  glm::vec3 tgt(0.0f, 0.0f, 0.0f);
+  //glm::vec3      tgt(0.0f, 3.0f, 0.0f);
+  glm::vec3 vec = tgt - pos;
+  tgt.y = pos.y + vec.y * ((pos.z - g_Context.debug_info.focus) / pos.z);
+  tgt.z = g_Context.debug_info.focus;
+  gluLookAt(pos.x, pos.y, pos.z, tgt.x, tgt.y, tgt.z, 0.0, 1.0, 0.0); // pos, tgt, up
+}
+
 void display(void){
   glClear(GL_ACCUM_BUFFER_BIT);
   int   num_accum = 8;
@@ -869,17 +768,7 @@ void display(void){
 
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
-    glm::vec3 pos(0.0f, 1.6f, 12.0f);
-    float eye_jitter = (pos.z - g_Context.debug_info.focus) / pos.z;
-    eye_jitter = (eye_jitter < 0.1f) ? 0.1f : eye_jitter;
-    pos.x += g_Context.debug_info.dof * j8[i].x * eye_jitter;
-    pos.y += g_Context.debug_info.dof * j8[i].y * eye_jitter;
-    glm::vec3 tgt(0.0f, 0.0f, 0.0f);
-    //glm::vec3      tgt(0.0f, 3.0f, 0.0f);
-    glm::vec3 vec = tgt - pos;
-    tgt.y = pos.y + vec.y * ((pos.z - g_Context.debug_info.focus) / pos.z);
-    tgt.z = g_Context.debug_info.focus;
-    gluLookAt(pos.x, pos.y, pos.z, tgt.x, tgt.y, tgt.z, 0.0, 1.0, 0.0); // pos, tgt, up
+    look_at(j8[i].x, j8[i].y);
 
     display_actor();
 
@@ -946,19 +835,66 @@ void idle(void){
   ctx.frame++;
 }
 
+// matrices of the unjittered camera, what the mouse picks against
+void camera_matrices(GLdouble model[16], GLdouble proj[16], GLint viewport[4]) {
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+    glLoadIdentity();
+    look_at(0.0f, 0.0f);
+    glGetDoublev(GL_MODELVIEW_MATRIX, model);
+  glPopMatrix();
+  glGetDoublev(GL_PROJECTION_MATRIX, proj);
+  glGetIntegerv(GL_VIEWPORT, viewport);
+}
+
+// window x y at window depth z to world space
+glm::vec3 unproject(int x, int y, GLdouble z) {
+  GLdouble model[16], proj[16], wx, wy, wz;
+  GLint    viewport[4];
+  camera_matrices(model, proj, viewport);
+  gluUnProject((GLdouble)x, (GLdouble)(viewport[3] - y), z, model, proj, viewport, &wx, &wy, &wz);
+  return glm::vec3((float)wx, (float)wy, (float)wz);
+}
+
 void mouse( int button, int state, int x, int y ){
-  if (button == GLUT_LEFT_BUTTON) {
-    switch(state){
-    case GLUT_DOWN:
-      break;
-    case GLUT_UP:
-      break;
+  auto& ctx = g_Context;
+  ImGui_ImplGLUT_MouseFunc(button, state, x, y);
+  if ((button != GLUT_LEFT_BUTTON) || !ctx.scene) {
+    return;
+  }
+  switch(state){
+  case GLUT_DOWN:
+    if (!ImGui::GetIO().WantCaptureMouse) {
+      glm::vec3 origin = unproject(x, y, 0.0);
+      glm::vec3 dir    = glm::normalize(unproject(x, y, 1.0) - origin);
+      float     t;
+      int       point;
+      if (ctx.scene->Pick(origin, dir, t, point)) {
+        glm::vec3 hit = origin + dir * t;
+        GLdouble  model[16], proj[16], wx, wy;
+        GLint     viewport[4];
+        camera_matrices(model, proj, viewport);
+        gluProject(hit.x, hit.y, hit.z, model, proj, viewport, &wx, &wy, &ctx.grab_depth);
+        ctx.grab_point = point;
+        ctx.scene->Grab(point, hit);
+      }
     }
+    break;
+  case GLUT_UP:
+    if (ctx.grab_point >= 0) {
+      ctx.scene->Release();
+      ctx.grab_point = -1;
+    }
+    break;
   }
 }
 
 void motion(int x, int y){
-
+  auto& ctx = g_Context;
+  ImGui_ImplGLUT_MotionFunc(x, y);
+  if ((ctx.grab_point >= 0) && ctx.scene) {
+    ctx.scene->Grab(ctx.grab_point, unproject(x, y, ctx.grab_depth));
+  }
 }
 
 int main(int argc, char* argv[]) {
@@ -977,8 +913,8 @@ int main(int argc, char* argv[]) {
   glutReshapeFunc(reshape);
   glutIdleFunc(idle);
 
-  //glutMouseFunc(mouse);     // ImGui_ImplGLUT_MouseFunc
-  //glutMotionFunc(motion);   // ImGui_ImplGLUT_MotionFunc
+  glutMouseFunc(mouse);     // calls ImGui_ImplGLUT_MouseFunc
+  glutMotionFunc(motion);   // calls ImGui_ImplGLUT_MotionFunc
   //glutKeyboardFunc(keyboard); // ImGui_ImplGLUT_KeyboardFunc
 
   glutMainLoop();